@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2026 EasyRPG Project
+ * This file is released under the MIT License
+ * http://opensource.org/licenses/MIT
+ */
+
+#include "batch.h"
+#include "jobpool.h"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+
+namespace fs = std::filesystem;
+
+namespace {
+	std::string ToLower(std::string s) {
+		std::transform(s.begin(), s.end(), s.begin(),
+			[](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		return s;
+	}
+
+	/** Returns a key that is equal for paths naming the same file. */
+	std::string OutputKey(const std::string& output) {
+		std::string key = fs::path(output).lexically_normal().generic_string();
+#ifdef _WIN32
+		key = ToLower(key);
+#endif
+		return key;
+	}
+}
+
+std::vector<Batch::Job> Batch::Collect(const std::vector<std::string>& inputs,
+	const Options& options, std::ostream& err) {
+	std::vector<Job> jobs;
+	fs::path output_dir(options.output_directory);
+	std::string extension = ToLower(options.input_extension);
+
+	for (const auto& input : inputs) {
+		std::error_code ec;
+
+		if (!fs::is_directory(input, ec)) {
+			// a file, missing files are reported by the conversion
+			fs::path output = output_dir / fs::path(input).stem();
+			output += options.output_extension;
+			jobs.push_back({ input, output.string(), {} });
+			continue;
+		}
+
+		std::vector<Job> dir_jobs;
+		fs::recursive_directory_iterator it(input, fs::directory_options::skip_permission_denied, ec);
+		for (; !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+			const fs::path& path = it->path();
+			if (!it->is_regular_file(ec) || ToLower(path.extension().string()) != extension) {
+				continue;
+			}
+
+			// mirror the directory structure below the output directory
+			fs::path output = output_dir / path.lexically_relative(input);
+			output.replace_extension(options.output_extension);
+			dir_jobs.push_back({ path.string(), output.string(), {} });
+		}
+		if (ec) {
+			err << "Error reading directory " << input << ": " << ec.message() << "." << std::endl;
+		}
+
+		std::sort(dir_jobs.begin(), dir_jobs.end(),
+			[](const Job& a, const Job& b) { return a.input < b.input; });
+		jobs.insert(jobs.end(), dir_jobs.begin(), dir_jobs.end());
+	}
+
+	// Two inputs with the same name would write the same output
+	std::unordered_map<std::string, size_t> outputs;
+	for (size_t i = 0; i < jobs.size(); i++) {
+		auto it = outputs.emplace(OutputKey(jobs[i].output), i);
+		if (!it.second) {
+			jobs[i].error = "Error: " + jobs[i].output + " is already written for "
+				+ jobs[it.first->second].input + ", skipped " + jobs[i].input + ".\n";
+		}
+	}
+
+	return jobs;
+}
+
+bool Batch::IsUpToDate(const Job& job) {
+	std::error_code ec;
+	auto output_time = fs::last_write_time(job.output, ec);
+	if (ec) {
+		return false;
+	}
+	auto input_time = fs::last_write_time(job.input, ec);
+	return !ec && output_time >= input_time;
+}
+
+size_t Batch::Run(const std::vector<Job>& jobs, const Options& options,
+	const std::function<bool(const Job& job, std::ostream& err)>& convert) {
+	std::mutex mutex;
+	size_t converted = 0;
+	size_t skipped = 0;
+	std::vector<std::string> failed;
+
+	auto run_job = [&](size_t i) {
+		const Job& job = jobs[i];
+
+		if (!job.error.empty()) {
+			std::lock_guard<std::mutex> lock(mutex);
+			std::cerr << job.error;
+			failed.push_back(job.input);
+			return;
+		}
+
+		if (options.update && IsUpToDate(job)) {
+			std::lock_guard<std::mutex> lock(mutex);
+			skipped++;
+			return;
+		}
+
+		std::error_code ec;
+		fs::path parent = fs::path(job.output).parent_path();
+		if (!parent.empty()) {
+			fs::create_directories(parent, ec);
+		}
+
+		std::ostringstream err;
+		bool success = convert(job, err);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		std::cerr << err.str();
+		if (success) {
+			converted++;
+		} else {
+			failed.push_back(job.input);
+		}
+	};
+
+	if (options.threads == 1 || jobs.size() < 2) {
+		for (size_t i = 0; i < jobs.size(); i++) {
+			run_job(i);
+		}
+	} else {
+		JobPool pool(options.threads);
+		pool.ParallelFor(jobs.size(), run_job);
+	}
+
+	if (jobs.size() > 1) {
+		std::cout << converted << " converted, " << skipped << " up to date, "
+			<< failed.size() << " failed" << std::endl;
+
+		std::sort(failed.begin(), failed.end());
+		for (const auto& input : failed) {
+			std::cerr << "Failed: " << input << std::endl;
+		}
+	}
+
+	return failed.size();
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2026 EasyRPG Project
+ * This file is released under the MIT License
+ * http://opensource.org/licenses/MIT
+ */
+
+#ifndef EASYRPG_TOOLS_BATCH_H
+#define EASYRPG_TOOLS_BATCH_H
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * Batch conversion helpers shared by the converters.
+ *
+ * Files given on the command line are written into the output directory,
+ * directories are searched recursively and mirrored below it.
+ */
+namespace Batch {
+	struct Job {
+		std::string input;
+		std::string output;
+		// set when the job cannot run, it is reported as failed
+		std::string error;
+	};
+
+	struct Options {
+		// extension of the files searched in directories, e.g. ".png"
+		std::string input_extension;
+		// extension of the written files, e.g. ".xyz"
+		std::string output_extension;
+		// target directory, empty for the current directory
+		std::string output_directory;
+		// skip jobs whose output is newer than the input
+		bool update = false;
+		// worker threads, 0: one per CPU core
+		unsigned int threads = 1;
+	};
+
+	/**
+	 * Expands the command line inputs into jobs.
+	 * Missing files are reported by the conversion. Inputs whose output is
+	 * already written by an earlier job (e.g. a/x.png and b/x.png) get an
+	 * error, so they never race on the same file.
+	 *
+	 * @param inputs files and directories
+	 * @param options batch options
+	 * @param err receives a message for every directory that cannot be read
+	 * @return jobs, sorted by input path for directories
+	 */
+	std::vector<Job> Collect(const std::vector<std::string>& inputs, const Options& options,
+		std::ostream& err);
+
+	/** Returns whether the output exists and is not older than the input. */
+	bool IsUpToDate(const Job& job);
+
+	/**
+	 * Runs convert for every job and prints the collected error messages.
+	 * Jobs with an error are not converted and count as failed.
+	 * Failing jobs do not stop the batch. When more than one job was given
+	 * a summary is printed at the end.
+	 *
+	 * @param jobs jobs from Collect
+	 * @param options batch options
+	 * @param convert conversion function, writes errors to the stream
+	 * @return amount of failed jobs
+	 */
+	size_t Run(const std::vector<Job>& jobs, const Options& options,
+		const std::function<bool(const Job& job, std::ostream& err)>& convert);
+}
+
+#endif
@@ -0,0 +1,263 @@
+/*
+ * Copyright (c) 2026 EasyRPG Project
+ * This file is released under the MIT License
+ * http://opensource.org/licenses/MIT
+ */
+
+#ifndef EASYRPG_TOOLS_JOBPOOL_H
+#define EASYRPG_TOOLS_JOBPOOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Work-stealing thread pool.
+ *
+ * Every worker owns a queue: it takes its own jobs from the back (newest
+ * first) and steals from the front of the other queues when it runs dry.
+ * Jobs submitted from a worker land in that worker's queue, so nested work
+ * (see ParallelFor) stays local unless somebody is idle.
+ */
+class JobPool {
+public:
+	using Job = std::function<void()>;
+
+	/** Creates a pool with the given amount of workers (0: one per CPU core). */
+	explicit JobPool(unsigned int threads = 0) {
+		if (threads == 0) {
+			threads = std::max(1u, std::thread::hardware_concurrency());
+		}
+
+		for (unsigned int i = 0; i < threads; i++) {
+			queues.emplace_back(std::make_unique<Queue>());
+		}
+		for (unsigned int i = 0; i < threads; i++) {
+			workers.emplace_back([this, i]() { WorkerMain(i); });
+		}
+	}
+
+	/** Finishes all queued jobs and joins the workers. */
+	~JobPool() {
+		Wait();
+		{
+			std::lock_guard<std::mutex> lock(wake_mutex);
+			stop = true;
+		}
+		wake_cv.notify_all();
+		for (auto& worker : workers) {
+			worker.join();
+		}
+	}
+
+	JobPool(const JobPool&) = delete;
+	JobPool& operator=(const JobPool&) = delete;
+
+	/** Returns the amount of worker threads. */
+	unsigned int GetThreadCount() const {
+		return static_cast<unsigned int>(workers.size());
+	}
+
+	/** Queues a job for execution. */
+	void Submit(Job job) {
+		Push(std::move(job), false);
+	}
+
+	/**
+	 * Blocks until all submitted jobs have finished.
+	 * Must not be called from inside a job, use ParallelFor there.
+	 */
+	void Wait() {
+		while (pending > 0) {
+			if (TryRunOne(npos)) {
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(wake_mutex);
+			idle_cv.wait(lock, [this]() { return pending == 0 || queued > 0; });
+		}
+	}
+
+	/**
+	 * Calls fn(i) for every i in [0, count) and returns when all calls
+	 * finished. The calling thread takes part in the work, so this is safe
+	 * to use from inside a job. While waiting for the last items it only
+	 * helps with other ParallelFor calls, a job from Submit could keep it
+	 * busy far longer than the items.
+	 */
+	void ParallelFor(size_t count, const std::function<void(size_t)>& fn) {
+		if (count == 0) {
+			return;
+		}
+
+		struct State {
+			std::function<void(size_t)> fn;
+			size_t count;
+			std::atomic<size_t> next{0};
+			std::atomic<size_t> done{0};
+			std::mutex mutex;
+			std::condition_variable cv;
+		};
+		auto state = std::make_shared<State>();
+		state->fn = fn;
+		state->count = count;
+
+		auto work = [](State& s) {
+			size_t i;
+			while ((i = s.next++) < s.count) {
+				s.fn(i);
+				if (++s.done == s.count) {
+					std::lock_guard<std::mutex> lock(s.mutex);
+					s.cv.notify_all();
+				}
+			}
+		};
+
+		size_t helpers = std::min(count - 1, queues.size());
+		for (size_t i = 0; i < helpers; i++) {
+			Push([state, work]() { work(*state); }, true);
+		}
+
+		work(*state);
+
+		// Help other ParallelFor calls while the last items are still running
+		size_t self = CurrentWorker();
+		while (state->done < count) {
+			if (TryRunOne(self, true)) {
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(state->mutex);
+			state->cv.wait_for(lock, std::chrono::milliseconds(1),
+				[&state, count]() { return state->done == count; });
+		}
+	}
+
+private:
+	static constexpr size_t npos = static_cast<size_t>(-1);
+
+	struct Entry {
+		Job job;
+		// queued by ParallelFor
+		bool nested;
+	};
+
+	struct Queue {
+		std::mutex mutex;
+		std::deque<Entry> jobs;
+	};
+
+	/** Index of the worker running on this thread, npos for foreign threads. */
+	size_t CurrentWorker() const {
+		return tls_pool == this ? tls_index : npos;
+	}
+
+	void Push(Job job, bool nested) {
+		size_t target = CurrentWorker();
+		if (target == npos) {
+			target = next_queue++ % queues.size();
+		}
+
+		pending++;
+		{
+			std::lock_guard<std::mutex> lock(wake_mutex);
+			queued++;
+		}
+		{
+			std::lock_guard<std::mutex> lock(queues[target]->mutex);
+			queues[target]->jobs.push_back({ std::move(job), nested });
+		}
+		wake_cv.notify_one();
+	}
+
+	/**
+	 * Removes the newest (or the oldest) job of a queue,
+	 * with nested_only the newest (oldest) one queued by ParallelFor.
+	 */
+	static bool Take(Queue& queue, bool newest, bool nested_only, Job& job) {
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		size_t size = queue.jobs.size();
+		for (size_t i = 0; i < size; i++) {
+			size_t k = newest ? size - 1 - i : i;
+			if (!nested_only || queue.jobs[k].nested) {
+				job = std::move(queue.jobs[k].job);
+				queue.jobs.erase(queue.jobs.begin() + k);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/**
+	 * Runs one queued job: own queue first, then steal from the others.
+	 * With nested_only jobs from Submit are left alone.
+	 */
+	bool TryRunOne(size_t self, bool nested_only = false) {
+		Job job;
+		bool found = self != npos && Take(*queues[self], true, nested_only, job);
+
+		size_t start = self == npos ? 0 : self + 1;
+		for (size_t i = 0; !found && i < queues.size(); i++) {
+			found = Take(*queues[(start + i) % queues.size()], false, nested_only, job);
+		}
+
+		if (!found) {
+			return false;
+		}
+
+		queued--;
+		job();
+
+		if (--pending == 0) {
+			std::lock_guard<std::mutex> lock(wake_mutex);
+			idle_cv.notify_all();
+		}
+		return true;
+	}
+
+	void WorkerMain(size_t index) {
+		tls_pool = this;
+		tls_index = index;
+
+		for (;;) {
+			if (TryRunOne(index)) {
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(wake_mutex);
+			wake_cv.wait(lock, [this]() { return stop || queued > 0; });
+			if (stop && queued == 0) {
+				break;
+			}
+		}
+
+		tls_pool = nullptr;
+	}
+
+	std::vector<std::unique_ptr<Queue>> queues;
+	std::vector<std::thread> workers;
+
+	std::mutex wake_mutex;
+	std::condition_variable wake_cv;
+	std::condition_variable idle_cv;
+	bool stop = false;
+
+	// jobs waiting in a queue
+	std::atomic<size_t> queued{0};
+	// jobs waiting or running
+	std::atomic<size_t> pending{0};
+	std::atomic<size_t> next_queue{0};
+
+	static inline thread_local const JobPool* tls_pool = nullptr;
+	static inline thread_local size_t tls_index = 0;
+};
+
+#endif
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2026 EasyRPG Project
+ * This file is released under the MIT License
+ * http://opensource.org/licenses/MIT
+ */
+
+#include "mappedfile.h"
+#include <fstream>
+#include <iterator>
+
+#ifdef _WIN32
+#  define WIN32_LEAN_AND_MEAN
+#  ifndef NOMINMAX
+#    define NOMINMAX
+#  endif
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+	Close();
+}
+
+bool MappedFile::Open(const std::string& filename) {
+	Close();
+
+#ifdef _WIN32
+	int len = MultiByteToWideChar(CP_UTF8, 0, filename.c_str(), -1, nullptr, 0);
+	std::wstring wfilename(len > 0 ? len - 1 : 0, L'\0');
+	if (len > 1) {
+		MultiByteToWideChar(CP_UTF8, 0, filename.c_str(), -1, &wfilename[0], len);
+	}
+
+	HANDLE file = CreateFileW(wfilename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+		OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file, &file_size)) {
+		CloseHandle(file);
+		return ReadFallback(filename);
+	}
+	if (file_size.QuadPart == 0) {
+		CloseHandle(file);
+		return true;
+	}
+
+	HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(file);
+	if (!mapping) {
+		return ReadFallback(filename);
+	}
+
+	// the view keeps the mapping alive
+	void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if (!view) {
+		return ReadFallback(filename);
+	}
+
+	data = static_cast<const uint8_t*>(view);
+	size = static_cast<size_t>(file_size.QuadPart);
+	mapped = true;
+	return true;
+#else
+	int fd = open(filename.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+		close(fd);
+		return ReadFallback(filename);
+	}
+	if (st.st_size == 0) {
+		close(fd);
+		return true;
+	}
+
+	// the mapping stays valid after closing the descriptor
+	void* view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (view == MAP_FAILED) {
+		return ReadFallback(filename);
+	}
+
+#ifdef MADV_SEQUENTIAL
+	madvise(view, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+#endif
+
+	data = static_cast<const uint8_t*>(view);
+	size = static_cast<size_t>(st.st_size);
+	mapped = true;
+	return true;
+#endif
+}
+
+void MappedFile::Close() {
+	if (mapped) {
+#ifdef _WIN32
+		UnmapViewOfFile(data);
+#else
+		munmap(const_cast<uint8_t*>(data), size);
+#endif
+	}
+
+	data = nullptr;
+	size = 0;
+	mapped = false;
+	buffer.clear();
+	buffer.shrink_to_fit();
+}
+
+bool MappedFile::ReadFallback(const std::string& filename) {
+	std::ifstream file(filename, std::ios::binary);
+	if (!file) {
+		return false;
+	}
+
+	buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	if (file.bad()) {
+		buffer.clear();
+		return false;
+	}
+
+	data = buffer.empty() ? nullptr : buffer.data();
+	size = buffer.size();
+	return true;
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2026 EasyRPG Project
+ * This file is released under the MIT License
+ * http://opensource.org/licenses/MIT
+ */
+
+#ifndef EASYRPG_TOOLS_MAPPEDFILE_H
+#define EASYRPG_TOOLS_MAPPEDFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Read-only view of a whole file.
+ *
+ * The file is memory mapped, so its contents can be handed to zlib as
+ * next_in without copying them first. Files that cannot be mapped (pipes,
+ * some network shares) are read into memory instead.
+ */
+class MappedFile {
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	/**
+	 * Opens and maps a file, closing the previous one.
+	 *
+	 * @param filename path (UTF-8 on Windows)
+	 * @return false when the file cannot be read
+	 */
+	bool Open(const std::string& filename);
+
+	/** Unmaps the file, GetData() becomes invalid. */
+	void Close();
+
+	/** Returns the file contents, nullptr for empty or closed files. */
+	const uint8_t* GetData() const { return data; }
+
+	/** Returns the file size. */
+	size_t GetSize() const { return size; }
+
+private:
+	bool ReadFallback(const std::string& filename);
+
+	const uint8_t* data = nullptr;
+	size_t size = 0;
+	bool mapped = false;
+	// contents when mapping failed
+	std::vector<uint8_t> buffer;
+};
+
+#endif
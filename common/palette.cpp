@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2026 EasyRPG Project
+ * This file is released under the MIT License
+ * http://opensource.org/licenses/MIT
+ */
+
+#include "palette.h"
+#include <zlib.h>
+#include <algorithm>
+#include <array>
+#include <numeric>
+
+namespace {
+	constexpr size_t palette_size = 768;
+	constexpr int palette_entries = 256;
+
+	int Luminance(const uint8_t* color) {
+		return color[0] * 299 + color[1] * 587 + color[2] * 114;
+	}
+
+	int Distance(const uint8_t* a, const uint8_t* b) {
+		int dr = a[0] - b[0];
+		int dg = a[1] - b[1];
+		int db = a[2] - b[2];
+		return dr * dr + dg * dg + db * db;
+	}
+
+	/** Size of the zlib stream of the payload, 0 on error. */
+	uLong CompressedSize(const std::vector<uint8_t>& payload, int level) {
+		uLong size = compressBound(payload.size());
+		std::vector<Bytef> buffer(size);
+		if (compress2(buffer.data(), &size, payload.data(), payload.size(), level) != Z_OK) {
+			return 0;
+		}
+		return size;
+	}
+}
+
+const char* Palette::GetOrderName(Order order) {
+	switch (order) {
+		case Order::Identity:
+			return "identity";
+		case Order::Frequency:
+			return "frequency";
+		case Order::Luminance:
+			return "luminance";
+		case Order::NearestNeighbour:
+			return "nearest neighbour";
+	}
+	return "";
+}
+
+std::vector<uint8_t> Palette::ComputeOrder(const std::vector<uint8_t>& payload, Order order) {
+	std::vector<uint8_t> mapping(palette_entries);
+	std::iota(mapping.begin(), mapping.end(), 0);
+
+	if (order == Order::Identity || payload.size() < palette_size) {
+		return mapping;
+	}
+
+	std::array<size_t, palette_entries> counts = {};
+	for (size_t i = palette_size; i < payload.size(); i++) {
+		counts[payload[i]]++;
+	}
+
+	// Entry 0 stays, the others are sorted: used ones first
+	std::vector<uint8_t> used, unused;
+	for (int i = 1; i < palette_entries; i++) {
+		(counts[i] > 0 ? used : unused).push_back(static_cast<uint8_t>(i));
+	}
+
+	auto color = [&payload](uint8_t index) { return &payload[index * 3]; };
+
+	switch (order) {
+		case Order::Frequency:
+			std::stable_sort(used.begin(), used.end(),
+				[&counts](uint8_t a, uint8_t b) { return counts[a] > counts[b]; });
+			break;
+		case Order::Luminance:
+			std::stable_sort(used.begin(), used.end(),
+				[&color](uint8_t a, uint8_t b) { return Luminance(color(a)) < Luminance(color(b)); });
+			break;
+		case Order::NearestNeighbour: {
+			std::vector<uint8_t> chain;
+			const uint8_t* last = color(0);
+			while (!used.empty()) {
+				auto next = std::min_element(used.begin(), used.end(),
+					[&color, last](uint8_t a, uint8_t b) {
+						return Distance(color(a), last) < Distance(color(b), last);
+					});
+				last = color(*next);
+				chain.push_back(*next);
+				used.erase(next);
+			}
+			used = std::move(chain);
+			break;
+		}
+		default:
+			break;
+	}
+
+	std::copy(used.begin(), used.end(), mapping.begin() + 1);
+	std::copy(unused.begin(), unused.end(), mapping.begin() + 1 + used.size());
+
+	return mapping;
+}
+
+void Palette::ApplyOrder(std::vector<uint8_t>& payload, const std::vector<uint8_t>& mapping) {
+	if (payload.size() < palette_size) {
+		return;
+	}
+
+	std::array<uint8_t, palette_entries> inverse;
+	std::vector<uint8_t> palette(payload.begin(), payload.begin() + palette_size);
+	for (int i = 0; i < palette_entries; i++) {
+		inverse[mapping[i]] = static_cast<uint8_t>(i);
+		std::copy_n(&palette[mapping[i] * 3], 3, &payload[i * 3]);
+	}
+
+	for (size_t i = palette_size; i < payload.size(); i++) {
+		payload[i] = inverse[payload[i]];
+	}
+}
+
+Palette::Order Palette::Optimize(std::vector<uint8_t>& payload, int level) {
+	Order best = Order::Identity;
+	std::vector<uint8_t> best_payload = payload;
+	uLong best_size = CompressedSize(payload, level);
+
+	for (Order order : {Order::Frequency, Order::Luminance, Order::NearestNeighbour}) {
+		std::vector<uint8_t> candidate = payload;
+		ApplyOrder(candidate, ComputeOrder(payload, order));
+
+		uLong size = CompressedSize(candidate, level);
+		if (size > 0 && (best_size == 0 || size < best_size)) {
+			best = order;
+			best_size = size;
+			best_payload = std::move(candidate);
+		}
+	}
+
+	payload = std::move(best_payload);
+	return best;
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2026 EasyRPG Project
+ * This file is released under the MIT License
+ * http://opensource.org/licenses/MIT
+ */
+
+#ifndef EASYRPG_TOOLS_PALETTE_H
+#define EASYRPG_TOOLS_PALETTE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Lossless palette reordering for XYZ payloads (768 byte palette followed
+ * by one index per pixel).
+ *
+ * Deflate codes every byte value independently, so relabeling the pixels
+ * does not change the LZ77 matches. What changes is the palette block and
+ * the Huffman tree headers, which get smaller when the used entries are
+ * grouped and similar colours are neighbours.
+ * Index 0 never moves: the engine uses it as transparent colour key.
+ */
+namespace Palette {
+	enum class Order {
+		// keep the current order
+		Identity,
+		// most used entries first
+		Frequency,
+		// dark to bright
+		Luminance,
+		// chain of closest colours, starting from entry 0
+		NearestNeighbour
+	};
+
+	/** Returns a name for the order, for console output. */
+	const char* GetOrderName(Order order);
+
+	/**
+	 * Computes a palette order for the payload.
+	 * Unused entries are moved behind the used ones.
+	 *
+	 * @param payload XYZ payload (palette and pixels)
+	 * @param order how to sort
+	 * @return new index -> old index mapping, [0] is always 0
+	 */
+	std::vector<uint8_t> ComputeOrder(const std::vector<uint8_t>& payload, Order order);
+
+	/** Reorders palette and pixels of the payload in place. */
+	void ApplyOrder(std::vector<uint8_t>& payload, const std::vector<uint8_t>& mapping);
+
+	/**
+	 * Tries all orders and keeps the one whose zlib stream is the smallest.
+	 *
+	 * @param payload XYZ payload, reordered in place
+	 * @param level zlib level used to compare the candidates
+	 * @return the order that was applied
+	 */
+	Order Optimize(std::vector<uint8_t>& payload, int level = 9);
+}
+
+#endif
@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2026 EasyRPG Project
+ * This file is released under the MIT License
+ * http://opensource.org/licenses/MIT
+ */
+
+#ifndef EASYRPG_TOOLS_PNGPROFILE_H
+#define EASYRPG_TOOLS_PNGPROFILE_H
+
+#include <array>
+#include <string>
+#include <zlib.h>
+
+/**
+ * PNG output settings, trading file size for writing speed.
+ *
+ * "best" is what the tools always did, "fast" is meant for previews and
+ * "store" writes uncompressed data for when even that is too slow.
+ */
+struct PngProfile {
+	// values of the PNG_FILTER_* flags of libpng (also used by wxWidgets)
+	static constexpr int filter_default = 0;
+	static constexpr int filter_none = 0x08;
+	static constexpr int filter_sub = 0x10;
+
+	const char* name;
+	const char* description;
+	// zlib settings
+	int level;
+	int mem_level;
+	int strategy;
+	// PNG_FILTER_* mask, filter_default keeps the choice of the library
+	int filters;
+};
+
+/** Returns all profiles, the first one is the default. */
+inline const std::array<PngProfile, 3>& GetPngProfiles() {
+	static const std::array<PngProfile, 3> profiles = {{
+		{ "best", "smallest files (default)", Z_BEST_COMPRESSION, MAX_MEM_LEVEL,
+			Z_DEFAULT_STRATEGY, PngProfile::filter_default },
+		{ "fast", "fast zlib level 1 with RLE, for previews", Z_BEST_SPEED, 8,
+			Z_RLE, PngProfile::filter_none | PngProfile::filter_sub },
+		{ "store", "uncompressed, largest files", Z_NO_COMPRESSION, 8,
+			Z_DEFAULT_STRATEGY, PngProfile::filter_none }
+	}};
+	return profiles;
+}
+
+/** Returns the profile with the given name or nullptr. */
+inline const PngProfile* FindPngProfile(const std::string& name) {
+	for (const auto& profile : GetPngProfiles()) {
+		if (name == profile.name) {
+			return &profile;
+		}
+	}
+	return nullptr;
+}
+
+/** Returns the help text of a profile option, one line per profile. */
+inline std::string GetPngProfileHelp() {
+	std::string help = "PNG output profile:";
+	for (const auto& profile : GetPngProfiles()) {
+		help += std::string("\n  ") + profile.name + ": " + profile.description;
+	}
+	return help;
+}
+
+#endif
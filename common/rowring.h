@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2026 EasyRPG Project
+ * This file is released under the MIT License
+ * http://opensource.org/licenses/MIT
+ */
+
+#ifndef EASYRPG_TOOLS_ROWRING_H
+#define EASYRPG_TOOLS_ROWRING_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+/**
+ * Bounded ring buffer of equally sized rows, connecting one producer
+ * thread with one consumer thread.
+ *
+ * The producer fills the slot returned by BeginWrite and publishes it with
+ * EndWrite, the consumer does the same with BeginRead/EndRead. Both sides
+ * block when the ring is full or empty, so memory stays at
+ * capacity * row_size no matter how large the image is.
+ */
+class RowRing {
+public:
+	RowRing(size_t row_size, size_t capacity) :
+		rows(row_size * capacity), row_size(row_size), capacity(capacity) {
+	}
+
+	RowRing(const RowRing&) = delete;
+	RowRing& operator=(const RowRing&) = delete;
+
+	/** Waits for a free slot, nullptr when the consumer gave up. */
+	uint8_t* BeginWrite() {
+		std::unique_lock<std::mutex> lock(mutex);
+		cv.wait(lock, [this]() { return aborted || count < capacity; });
+		if (aborted) {
+			return nullptr;
+		}
+		return &rows[((head + count) % capacity) * row_size];
+	}
+
+	/** Hands the slot from BeginWrite to the consumer. */
+	void EndWrite() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			count++;
+		}
+		cv.notify_all();
+	}
+
+	/** Waits for a row, nullptr when the producer closed an empty ring. */
+	const uint8_t* BeginRead() {
+		std::unique_lock<std::mutex> lock(mutex);
+		cv.wait(lock, [this]() { return aborted || closed || count > 0; });
+		if (aborted || count == 0) {
+			return nullptr;
+		}
+		return &rows[head * row_size];
+	}
+
+	/** Releases the row from BeginRead. */
+	void EndRead() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			head = (head + 1) % capacity;
+			count--;
+		}
+		cv.notify_all();
+	}
+
+	/** Called by the producer when no more rows follow (also on error). */
+	void Close() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			closed = true;
+		}
+		cv.notify_all();
+	}
+
+	/** Called by the consumer to stop the producer. */
+	void Abort() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			aborted = true;
+		}
+		cv.notify_all();
+	}
+
+private:
+	std::vector<uint8_t> rows;
+	size_t row_size;
+	size_t capacity;
+
+	std::mutex mutex;
+	std::condition_variable cv;
+	// first filled slot and amount of filled slots
+	size_t head = 0;
+	size_t count = 0;
+	bool closed = false;
+	bool aborted = false;
+};
+
+#endif
@@ -0,0 +1,27 @@
+/*
+ * Copyright (c) 2026 EasyRPG Project
+ * This file is released under the MIT License
+ * http://opensource.org/licenses/MIT
+ */
+
+#include "tempname.h"
+#include <atomic>
+#include <cstdint>
+#include <random>
+#include <sstream>
+
+#ifdef _WIN32
+#  include <process.h>
+#  define getpid _getpid
+#else
+#  include <unistd.h>
+#endif
+
+std::string MakeTempName(const std::string& path) {
+	static std::atomic<uint32_t> counter{0};
+	static const uint32_t salt = std::random_device()();
+
+	std::ostringstream ss;
+	ss << path << ".tmp" << getpid() << "-" << counter++ << "-" << std::hex << salt;
+	return ss.str();
+}
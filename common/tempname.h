@@ -0,0 +1,22 @@
+/*
+ * Copyright (c) 2026 EasyRPG Project
+ * This file is released under the MIT License
+ * http://opensource.org/licenses/MIT
+ */
+
+#ifndef EASYRPG_TOOLS_TEMPNAME_H
+#define EASYRPG_TOOLS_TEMPNAME_H
+
+#include <string>
+
+/**
+ * Returns a name next to path for a file that is written completely and
+ * then renamed into place.
+ *
+ * The name contains the process id, a per-process counter and a random
+ * number, so threads and concurrent runs (also on other machines sharing
+ * the directory) never write the same temporary file.
+ */
+std::string MakeTempName(const std::string& path);
+
+#endif
@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2026 EasyRPG Project
+ * This file is released under the MIT License
+ * http://opensource.org/licenses/MIT
+ */
+
+#include "xyzreader.h"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+namespace {
+	// refill size for callback and stream input
+	constexpr size_t input_buffer_size = 64 * 1024;
+}
+
+XyzReader::XyzReader() = default;
+
+XyzReader::~XyzReader() {
+	if (stream_init) {
+		inflateEnd(&stream);
+	}
+}
+
+bool XyzReader::Open(ReadFunc func) {
+	read = std::move(func);
+	buffer.resize(input_buffer_size);
+	input = nullptr;
+	input_left = 0;
+	return Begin();
+}
+
+bool XyzReader::Open(std::istream& in) {
+	return Open([&in](uint8_t* data, size_t size) -> size_t {
+		in.read(reinterpret_cast<char*>(data), size);
+		return static_cast<size_t>(in.gcount());
+	});
+}
+
+bool XyzReader::Open(const uint8_t* data, size_t size) {
+	read = nullptr;
+	buffer.clear();
+	input = data;
+	input_left = size;
+	return Begin();
+}
+
+bool XyzReader::ReadRow(uint8_t* row) {
+	if (next_row >= height) {
+		return Fail("No more rows to read");
+	}
+
+	if (!Inflate(row, width)) {
+		next_row = height;
+		return false;
+	}
+
+	if (++next_row == height) {
+		return Finish();
+	}
+	return true;
+}
+
+bool XyzReader::ReadRows(uint8_t* pixels) {
+	while (next_row < height) {
+		if (!ReadRow(pixels)) {
+			return false;
+		}
+		pixels += width;
+	}
+	return true;
+}
+
+bool XyzReader::ReadPayload(std::vector<uint8_t>& payload) {
+	payload.resize(palette_size + static_cast<size_t>(height - next_row) * width);
+	memcpy(payload.data(), palette, palette_size);
+	return ReadRows(payload.data() + palette_size);
+}
+
+bool XyzReader::Begin() {
+	if (stream_init) {
+		inflateEnd(&stream);
+		stream_init = false;
+	}
+	stream = {};
+	width = 0;
+	height = 0;
+	next_row = 0;
+	error.clear();
+
+	uint8_t header[8];
+	if (!ReadRaw(header, sizeof(header))) {
+		return Fail("File is too short");
+	}
+	if (memcmp(header, "XYZ1", 4) != 0) {
+		return Fail("Not a XYZ file");
+	}
+
+	// dimensions are little endian
+	width = header[4] | (header[5] << 8);
+	height = header[6] | (header[7] << 8);
+
+	if (inflateInit(&stream) != Z_OK) {
+		return Fail("Failed to initialize zlib");
+	}
+	stream_init = true;
+
+	if (!Inflate(palette, palette_size)) {
+		next_row = height;
+		return false;
+	}
+
+	if (width == 0 || height == 0) {
+		next_row = height;
+		return Finish();
+	}
+	return true;
+}
+
+bool XyzReader::FillInput() {
+	if (stream.avail_in > 0) {
+		return true;
+	}
+
+	if (input_left > 0) {
+		size_t chunk = std::min<size_t>(input_left, UINT_MAX);
+		stream.next_in = const_cast<Bytef*>(input);
+		stream.avail_in = static_cast<uInt>(chunk);
+		input += chunk;
+		input_left -= chunk;
+		return true;
+	}
+
+	if (read) {
+		size_t got = read(buffer.data(), buffer.size());
+		stream.next_in = buffer.data();
+		stream.avail_in = static_cast<uInt>(got);
+		return got > 0;
+	}
+
+	return false;
+}
+
+bool XyzReader::ReadRaw(uint8_t* data, size_t size) {
+	while (size > 0) {
+		if (!FillInput()) {
+			return false;
+		}
+
+		size_t chunk = std::min<size_t>(size, stream.avail_in);
+		memcpy(data, stream.next_in, chunk);
+		stream.next_in += chunk;
+		stream.avail_in -= static_cast<uInt>(chunk);
+		data += chunk;
+		size -= chunk;
+	}
+	return true;
+}
+
+bool XyzReader::Inflate(uint8_t* data, size_t size) {
+	stream.next_out = data;
+	stream.avail_out = static_cast<uInt>(size);
+
+	while (stream.avail_out > 0) {
+		if (!FillInput()) {
+			return Fail("Image data is truncated");
+		}
+
+		int status = inflate(&stream, Z_NO_FLUSH);
+		if (status == Z_STREAM_END) {
+			if (stream.avail_out > 0) {
+				return Fail("Image data is too short");
+			}
+			break;
+		}
+		if (status != Z_OK) {
+			return Fail(stream.msg ? stream.msg : "Image data is corrupted");
+		}
+	}
+	return true;
+}
+
+bool XyzReader::Finish() {
+	// Drive zlib to the end of the stream, this also verifies the checksum
+	uint8_t extra;
+	stream.next_out = &extra;
+	stream.avail_out = 1;
+
+	for (;;) {
+		int status = inflate(&stream, Z_NO_FLUSH);
+		if (stream.avail_out == 0) {
+			return Fail("Image data is too long");
+		}
+		if (status == Z_STREAM_END) {
+			return true;
+		}
+		if (status != Z_OK && status != Z_BUF_ERROR) {
+			return Fail(stream.msg ? stream.msg : "Image data is corrupted");
+		}
+		if (stream.avail_in == 0 && !FillInput()) {
+			return Fail("Image data is truncated");
+		}
+	}
+}
+
+bool XyzReader::Fail(const char* message) {
+	error = message;
+	return false;
+}
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2026 EasyRPG Project
+ * This file is released under the MIT License
+ * http://opensource.org/licenses/MIT
+ */
+
+#ifndef EASYRPG_TOOLS_XYZREADER_H
+#define EASYRPG_TOOLS_XYZREADER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <string>
+#include <vector>
+#include <zlib.h>
+
+/**
+ * Incremental XYZ decoder.
+ *
+ * The header is parsed on Open, afterwards the palette and the pixel rows
+ * are inflated on demand. Only a small input buffer is kept, so decoding
+ * needs one row of memory instead of the whole compressed and
+ * decompressed image.
+ *
+ * Usage: Open, GetWidth/GetHeight/GetPalette, ReadRow for every row.
+ * After the last row the zlib trailer is verified, a stream that is
+ * truncated, damaged or longer than the image makes ReadRow fail.
+ */
+class XyzReader {
+public:
+	static constexpr size_t palette_size = 768;
+
+	/**
+	 * Input callback: copies up to size bytes into buffer.
+	 * Returns the amount of bytes copied, 0 at the end of the input.
+	 */
+	using ReadFunc = std::function<size_t(uint8_t* buffer, size_t size)>;
+
+	XyzReader();
+	~XyzReader();
+
+	XyzReader(const XyzReader&) = delete;
+	XyzReader& operator=(const XyzReader&) = delete;
+
+	/** Decodes from a callback. */
+	bool Open(ReadFunc read);
+
+	/** Decodes from a stream, which must outlive the reader. */
+	bool Open(std::istream& stream);
+
+	/** Decodes from memory, the data must outlive the reader. */
+	bool Open(const uint8_t* data, size_t size);
+
+	/** Returns the image width. */
+	int GetWidth() const { return width; }
+
+	/** Returns the image height. */
+	int GetHeight() const { return height; }
+
+	/** Returns the palette, 256 RGB triplets. */
+	const uint8_t* GetPalette() const { return palette; }
+
+	/**
+	 * Inflates the next row of indices.
+	 *
+	 * @param row receives GetWidth() bytes
+	 * @return false on error or when all rows were read
+	 */
+	bool ReadRow(uint8_t* row);
+
+	/**
+	 * Inflates all remaining rows.
+	 *
+	 * @param pixels receives (remaining rows * GetWidth()) bytes
+	 * @return whether all rows were read
+	 */
+	bool ReadRows(uint8_t* pixels);
+
+	/**
+	 * Convenience for tools that need the whole image: fills payload with
+	 * the palette followed by all pixels, the layout of an XYZ file.
+	 */
+	bool ReadPayload(std::vector<uint8_t>& payload);
+
+	/** Returns the reason why the last call failed. */
+	const std::string& GetError() const { return error; }
+
+private:
+	bool Begin();
+	bool FillInput();
+	bool ReadRaw(uint8_t* data, size_t size);
+	bool Inflate(uint8_t* data, size_t size);
+	bool Finish();
+	bool Fail(const char* message);
+
+	ReadFunc read;
+	std::vector<uint8_t> buffer;
+	// memory input not yet handed to zlib
+	const uint8_t* input = nullptr;
+	size_t input_left = 0;
+
+	z_stream stream = {};
+	bool stream_init = false;
+
+	int width = 0;
+	int height = 0;
+	int next_row = 0;
+	uint8_t palette[palette_size] = {};
+	std::string error;
+};
+
+#endif
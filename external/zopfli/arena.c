@@ -0,0 +1,199 @@
+/*
+Copyright 2026 EasyRPG Project. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_MSC_VER)
+#define ZOPFLI_THREAD_LOCAL __declspec(thread)
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#define ZOPFLI_THREAD_LOCAL _Thread_local
+#else
+#define ZOPFLI_THREAD_LOCAL __thread
+#endif
+
+/*
+Size classes: powers of two from 2^ZOPFLI_ARENA_MIN_CLASS up to
+2^ZOPFLI_ARENA_FINE_CLASS bytes, above that every power of two is split into
+ZOPFLI_ARENA_STEPS steps, so big buffers waste at most 1/ZOPFLI_ARENA_STEPS
+of their size. Smaller requests are rounded up to the first class.
+*/
+#define ZOPFLI_ARENA_MIN_CLASS 6
+#define ZOPFLI_ARENA_FINE_CLASS 16
+#define ZOPFLI_ARENA_STEPS_LOG2 3
+#define ZOPFLI_ARENA_STEPS (1u << ZOPFLI_ARENA_STEPS_LOG2)
+#define ZOPFLI_ARENA_COARSE_CLASSES \
+  (ZOPFLI_ARENA_FINE_CLASS - ZOPFLI_ARENA_MIN_CLASS + 1)
+#define ZOPFLI_ARENA_NUM_CLASSES (ZOPFLI_ARENA_COARSE_CLASSES \
+  + (sizeof(size_t) * 8 - 1 - ZOPFLI_ARENA_FINE_CLASS) * ZOPFLI_ARENA_STEPS)
+/* Bigger requests are not rounded, their class would overflow size_t. */
+#define ZOPFLI_ARENA_MAX_SIZE ((size_t)1 << (sizeof(size_t) * 8 - 1))
+
+/*
+Precedes every block. The union keeps the data behind it aligned like
+malloc does.
+*/
+typedef union ArenaHeader {
+  struct {
+    size_t capacity;  /* Usable bytes behind the header. */
+    union ArenaHeader* next;  /* Next free block of the same class. */
+  } block;
+  long double align_ld;
+  void* align_p;
+} ArenaHeader;
+
+struct ZopfliArena {
+  /*
+  Free blocks, list i holds blocks with a capacity of at least
+  ClassCapacity(i) bytes, so any of them fits a request of that size.
+  */
+  ArenaHeader* free[ZOPFLI_ARENA_NUM_CLASSES];
+  size_t cached;
+  size_t max_cached;
+};
+
+static ZOPFLI_THREAD_LOCAL ZopfliArena* thread_arena = 0;
+
+/* Returns the capacity of the blocks of a class. */
+static size_t ClassCapacity(unsigned c) {
+  unsigned k, j;
+  if (c < ZOPFLI_ARENA_COARSE_CLASSES) {
+    return (size_t)1 << (c + ZOPFLI_ARENA_MIN_CLASS);
+  }
+  c -= ZOPFLI_ARENA_COARSE_CLASSES;
+  k = ZOPFLI_ARENA_FINE_CLASS + c / ZOPFLI_ARENA_STEPS;
+  j = c % ZOPFLI_ARENA_STEPS;
+  return ((size_t)1 << k) + (j + 1) * ((size_t)1 << (k - ZOPFLI_ARENA_STEPS_LOG2));
+}
+
+/*
+Returns the smallest class whose blocks fit size bytes, size must not exceed
+ZOPFLI_ARENA_MAX_SIZE.
+*/
+static unsigned SizeToClass(size_t size) {
+  unsigned k = ZOPFLI_ARENA_MIN_CLASS;
+  size_t step;
+  if (size <= ((size_t)1 << ZOPFLI_ARENA_FINE_CLASS)) {
+    while (((size_t)1 << k) < size) k++;
+    return k - ZOPFLI_ARENA_MIN_CLASS;
+  }
+
+  /* 2^k < size <= 2^(k+1), then the step within that range. */
+  k = ZOPFLI_ARENA_FINE_CLASS;
+  while ((size - 1) >> (k + 1)) k++;
+  step = (size_t)1 << (k - ZOPFLI_ARENA_STEPS_LOG2);
+  return ZOPFLI_ARENA_COARSE_CLASSES + (k - ZOPFLI_ARENA_FINE_CLASS) * ZOPFLI_ARENA_STEPS
+      + (unsigned)((size - ((size_t)1 << k) + step - 1) / step) - 1;
+}
+
+/* Returns the biggest class served by a block of the given capacity. */
+static unsigned CapacityToClass(size_t capacity) {
+  unsigned c = SizeToClass(capacity);
+  if (ClassCapacity(c) > capacity) c--;
+  return c;
+}
+
+ZopfliArena* ZopfliCreateArena(size_t max_cached) {
+  ZopfliArena* arena = (ZopfliArena*)malloc(sizeof(*arena));
+  if (!arena) return 0;
+  memset(arena->free, 0, sizeof(arena->free));
+  arena->cached = 0;
+  arena->max_cached = max_cached;
+  return arena;
+}
+
+void ZopfliDestroyArena(ZopfliArena* arena) {
+  size_t i;
+  if (!arena) return;
+  for (i = 0; i < ZOPFLI_ARENA_NUM_CLASSES; i++) {
+    ArenaHeader* header = arena->free[i];
+    while (header) {
+      ArenaHeader* next = header->block.next;
+      free(header);
+      header = next;
+    }
+  }
+  free(arena);
+}
+
+ZopfliArena* ZopfliSetThreadArena(ZopfliArena* arena) {
+  ZopfliArena* previous = thread_arena;
+  thread_arena = arena;
+  return previous;
+}
+
+void* ZopfliArenaMalloc(size_t size) {
+  ZopfliArena* arena = thread_arena;
+  ArenaHeader* header;
+  size_t capacity = size;
+
+  if (arena && size <= ZOPFLI_ARENA_MAX_SIZE) {
+    unsigned c = SizeToClass(size);
+    header = arena->free[c];
+    if (header) {
+      arena->free[c] = header->block.next;
+      arena->cached -= header->block.capacity;
+      return header + 1;
+    }
+    /* Rounded up, so the block can serve the whole class later. */
+    capacity = ClassCapacity(c);
+  }
+
+  if (capacity > (size_t)-1 - sizeof(ArenaHeader)) return 0;
+  header = (ArenaHeader*)malloc(sizeof(ArenaHeader) + capacity);
+  if (!header) return 0;
+  header->block.capacity = capacity;
+  return header + 1;
+}
+
+void* ZopfliArenaRealloc(void* ptr, size_t size) {
+  ArenaHeader* header;
+  void* result;
+
+  if (!ptr) return ZopfliArenaMalloc(size);
+
+  header = (ArenaHeader*)ptr - 1;
+  if (header->block.capacity >= size) return ptr;
+
+  result = ZopfliArenaMalloc(size);
+  if (!result) return 0;
+  memcpy(result, ptr, header->block.capacity);
+  ZopfliArenaFree(ptr);
+  return result;
+}
+
+void ZopfliArenaFree(void* ptr) {
+  ZopfliArena* arena = thread_arena;
+  ArenaHeader* header;
+  unsigned c;
+
+  if (!ptr) return;
+  header = (ArenaHeader*)ptr - 1;
+
+  if (!arena || header->block.capacity < ((size_t)1 << ZOPFLI_ARENA_MIN_CLASS)
+      || header->block.capacity > ZOPFLI_ARENA_MAX_SIZE
+      || header->block.capacity > arena->max_cached - arena->cached) {
+    free(header);
+    return;
+  }
+
+  c = CapacityToClass(header->block.capacity);
+  header->block.next = arena->free[c];
+  arena->free[c] = header;
+  arena->cached += header->block.capacity;
+}
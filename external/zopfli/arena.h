@@ -0,0 +1,96 @@
+/*
+Copyright 2026 EasyRPG Project. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+/*
+Recycles the big temporary buffers of Zopfli (hash tables, the longest match
+cache, the LZ77 stores and the squeeze arrays) between blocks and between
+files, instead of returning them to malloc after every block.
+
+An arena belongs to one thread at a time. Blocks are plain heap blocks with a
+small header, so a block may be freed on a different thread than the one that
+allocated it; it then goes to the arena of the freeing thread. When no arena
+is installed the functions behave like malloc, realloc and free.
+*/
+
+#ifndef ZOPFLI_ARENA_H_
+#define ZOPFLI_ARENA_H_
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ZopfliArena ZopfliArena;
+
+/*
+Creates an empty arena. At most max_cached bytes of freed blocks are kept,
+larger blocks and the blocks beyond that are returned to the system.
+*/
+ZopfliArena* ZopfliCreateArena(size_t max_cached);
+
+/* Frees all blocks kept by the arena. It must not be installed anymore. */
+void ZopfliDestroyArena(ZopfliArena* arena);
+
+/*
+Installs the arena for the calling thread, 0 uninstalls it. Returns the arena
+installed before.
+*/
+ZopfliArena* ZopfliSetThreadArena(ZopfliArena* arena);
+
+/* Allocates from the arena of the calling thread. Returns 0 on failure. */
+void* ZopfliArenaMalloc(size_t size);
+
+/*
+Grows a block from ZopfliArenaMalloc, ptr may be 0. The block is kept when it
+is already big enough. Returns 0 on failure, ptr stays valid then.
+*/
+void* ZopfliArenaRealloc(void* ptr, size_t size);
+
+/* Returns a block from ZopfliArenaMalloc to the arena of the calling thread. */
+void ZopfliArenaFree(void* ptr);
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+/*
+Like ZOPFLI_APPEND_DATA, for arrays allocated with ZopfliArenaMalloc.
+*/
+#ifdef __cplusplus /* C++ cannot assign void* from malloc to *data */
+#define ZOPFLI_ARENA_APPEND_DATA(/* T */ value, /* T** */ data, /* size_t* */ size) {\
+  if (!((*size) & ((*size) - 1))) {\
+    /*double alloc size if it's a power of two*/\
+    void** data_void = reinterpret_cast<void**>(data);\
+    *data_void = ZopfliArenaRealloc((*data),\
+        ((*size) == 0 ? 1 : (*size) * 2) * sizeof(**data));\
+  }\
+  (*data)[(*size)] = (value);\
+  (*size)++;\
+}
+#else
+#define ZOPFLI_ARENA_APPEND_DATA(/* T */ value, /* T** */ data, /* size_t* */ size) {\
+  if (!((*size) & ((*size) - 1))) {\
+    /*double alloc size if it's a power of two*/\
+    (*data) = ZopfliArenaRealloc((*data),\
+        ((*size) == 0 ? 1 : (*size) * 2) * sizeof(**data));\
+  }\
+  (*data)[(*size)] = (value);\
+  (*size)++;\
+}
+#endif
+
+#endif  /* ZOPFLI_ARENA_H_ */
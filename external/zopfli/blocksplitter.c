@@ -23,6 +23,7 @@ Author: jyrki.alakuijala@gmail.com (Jyrki Alakuijala)
 #include <stdio.h>
 #include <stdlib.h>
 
+#include "arena.h"
 #include "deflate.h"
 #include "squeeze.h"
 #include "tree.h"
@@ -224,7 +225,7 @@ void ZopfliBlockSplitLZ77(const ZopfliOptions* options,
 
   if (lz77->size < 10) return;  /* This code fails on tiny files. */
 
-  done = (unsigned char*)malloc(lz77->size);
+  done = (unsigned char*)ZopfliArenaMalloc(lz77->size);
   if (!done) exit(-1); /* Allocation failed. */
   for (i = 0; i < lz77->size; i++) done[i] = 0;
 
@@ -269,7 +270,7 @@ void ZopfliBlockSplitLZ77(const ZopfliOptions* options,
     PrintBlockSplitPoints(lz77, *splitpoints, *npoints);
   }
 
-  free(done);
+  ZopfliArenaFree(done);
 }
 
 void ZopfliBlockSplit(const ZopfliOptions* options,
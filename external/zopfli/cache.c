@@ -18,6 +18,7 @@ Author: jyrki.alakuijala@gmail.com (Jyrki Alakuijala)
 */
 
 #include "cache.h"
+#include "arena.h"
 
 #include <assert.h>
 #include <stdio.h>
@@ -27,10 +28,13 @@ Author: jyrki.alakuijala@gmail.com (Jyrki Alakuijala)
 
 void ZopfliInitCache(size_t blocksize, ZopfliLongestMatchCache* lmc) {
   size_t i;
-  lmc->length = (unsigned short*)malloc(sizeof(unsigned short) * blocksize);
-  lmc->dist = (unsigned short*)malloc(sizeof(unsigned short) * blocksize);
+  lmc->length =
+      (unsigned short*)ZopfliArenaMalloc(sizeof(unsigned short) * blocksize);
+  lmc->dist =
+      (unsigned short*)ZopfliArenaMalloc(sizeof(unsigned short) * blocksize);
   /* Rather large amount of memory. */
-  lmc->sublen = (unsigned char*)malloc(ZOPFLI_CACHE_LENGTH * 3 * blocksize);
+  lmc->sublen =
+      (unsigned char*)ZopfliArenaMalloc(ZOPFLI_CACHE_LENGTH * 3 * blocksize);
   if(lmc->sublen == NULL) {
     fprintf(stderr,
         "Error: Out of memory. Tried allocating %lu bytes of memory.\n",
@@ -46,9 +50,9 @@ void ZopfliInitCache(size_t blocksize, ZopfliLongestMatchCache* lmc) {
 }
 
 void ZopfliCleanCache(ZopfliLongestMatchCache* lmc) {
-  free(lmc->length);
-  free(lmc->dist);
-  free(lmc->sublen);
+  ZopfliArenaFree(lmc->length);
+  ZopfliArenaFree(lmc->dist);
+  ZopfliArenaFree(lmc->sublen);
 }
 
 void ZopfliSublenToCache(const unsigned short* sublen,
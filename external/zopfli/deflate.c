@@ -799,6 +799,141 @@ static void AddLZ77BlockAutoType(const ZopfliOptions* options, int final,
   ZopfliCleanLZ77Store(&fixedstore);
 }
 
+/*
+Runs job(context, i) for every i in [0, count), through the parallel_for hook
+of the options if there is one.
+*/
+static void RunJobs(const ZopfliOptions* options, size_t count,
+                    void (*job)(void* context, size_t i), void* context) {
+  size_t i;
+  if (options->parallel_for && count > 1) {
+    options->parallel_for(options->parallel_opaque, count, job, context);
+    return;
+  }
+  for (i = 0; i < count; i++) job(context, i);
+}
+
+/* Input and results of the LZ77 optimization of the blocks of one part. */
+typedef struct BlockJobs {
+  const ZopfliOptions* options;
+  const unsigned char* in;
+  size_t instart;
+  size_t inend;
+  const size_t* splitpoints;
+  size_t npoints;
+  ZopfliLZ77Store* stores;
+  double* costs;
+} BlockJobs;
+
+static void OptimizeBlock(void* context, size_t i) {
+  BlockJobs* jobs = (BlockJobs*)context;
+  size_t start = i == 0 ? jobs->instart : jobs->splitpoints[i - 1];
+  size_t end = i == jobs->npoints ? jobs->inend : jobs->splitpoints[i];
+  ZopfliBlockState s;
+  ZopfliInitLZ77Store(jobs->in, &jobs->stores[i]);
+  ZopfliInitBlockState(jobs->options, start, end, 1, &s);
+  ZopfliLZ77Optimal(&s, jobs->in, start, end, jobs->options->numiterations,
+                    &jobs->stores[i]);
+  jobs->costs[i] = ZopfliCalculateBlockSizeAutoType(&jobs->stores[i], 0,
+                                                    jobs->stores[i].size);
+  ZopfliCleanBlockState(&s);
+}
+
+/*
+Finds the blocks and the optimal LZ77 representation of a part for dynamic
+deflate blocks, this is the expensive part of ZopfliDeflatePart. The result
+does not depend on earlier output, so parts can be processed concurrently.
+lz77: initialized store that receives the LZ77 data of the whole part.
+splitpoints: receives the block boundaries as lz77 indices, must be freed.
+*/
+static void DeflatePartLZ77(const ZopfliOptions* options,
+                            const unsigned char* in,
+                            size_t instart, size_t inend,
+                            ZopfliLZ77Store* lz77,
+                            size_t** splitpoints, size_t* npoints) {
+  size_t i;
+  /* byte coordinates rather than lz77 index */
+  size_t* splitpoints_uncompressed = 0;
+  double totalcost = 0;
+  BlockJobs jobs;
+
+  *splitpoints = 0;
+  *npoints = 0;
+
+  if (options->blocksplitting) {
+    ZopfliBlockSplit(options, in, instart, inend,
+                     options->blocksplittingmax,
+                     &splitpoints_uncompressed, npoints);
+    *splitpoints = (size_t*)malloc(sizeof(**splitpoints) * *npoints);
+  }
+
+  /* The blocks are independent of each other, optimize them all at once */
+  jobs.options = options;
+  jobs.in = in;
+  jobs.instart = instart;
+  jobs.inend = inend;
+  jobs.splitpoints = splitpoints_uncompressed;
+  jobs.npoints = *npoints;
+  jobs.stores = (ZopfliLZ77Store*)malloc(sizeof(*jobs.stores) * (*npoints + 1));
+  jobs.costs = (double*)malloc(sizeof(*jobs.costs) * (*npoints + 1));
+  if (!jobs.stores || !jobs.costs) exit(-1); /* Allocation failed. */
+  RunJobs(options, *npoints + 1, OptimizeBlock, &jobs);
+
+  /* Merge in input order, so the result matches the serial one */
+  for (i = 0; i <= *npoints; i++) {
+    totalcost += jobs.costs[i];
+
+    ZopfliAppendLZ77Store(&jobs.stores[i], lz77);
+    if (i < *npoints) (*splitpoints)[i] = lz77->size;
+
+    ZopfliCleanLZ77Store(&jobs.stores[i]);
+  }
+  free(jobs.stores);
+  free(jobs.costs);
+
+  /* Second block splitting attempt */
+  if (options->blocksplitting && *npoints > 1) {
+    size_t* splitpoints2 = 0;
+    size_t npoints2 = 0;
+    double totalcost2 = 0;
+
+    ZopfliBlockSplitLZ77(options, lz77,
+                         options->blocksplittingmax, &splitpoints2, &npoints2);
+
+    for (i = 0; i <= npoints2; i++) {
+      size_t start = i == 0 ? 0 : splitpoints2[i - 1];
+      size_t end = i == npoints2 ? lz77->size : splitpoints2[i];
+      totalcost2 += ZopfliCalculateBlockSizeAutoType(lz77, start, end);
+    }
+
+    if (totalcost2 < totalcost) {
+      free(*splitpoints);
+      *splitpoints = splitpoints2;
+      *npoints = npoints2;
+    } else {
+      free(splitpoints2);
+    }
+  }
+
+  free(splitpoints_uncompressed);
+}
+
+/* Writes the blocks found by DeflatePartLZ77 to the output. */
+static void AddLZ77Blocks(const ZopfliOptions* options, int final,
+                          const ZopfliLZ77Store* lz77,
+                          const size_t* splitpoints, size_t npoints,
+                          unsigned char* bp,
+                          unsigned char** out, size_t* outsize) {
+  size_t i;
+  for (i = 0; i <= npoints; i++) {
+    size_t start = i == 0 ? 0 : splitpoints[i - 1];
+    size_t end = i == npoints ? lz77->size : splitpoints[i];
+    AddLZ77BlockAutoType(options, i == npoints && final,
+                         lz77, start, end, 0,
+                         bp, out, outsize);
+  }
+}
+
 /*
 Deflate a part, to allow ZopfliDeflate() to use multiple master blocks if
 needed.
@@ -812,12 +947,8 @@ void ZopfliDeflatePart(const ZopfliOptions* options, int btype, int final,
                        const unsigned char* in, size_t instart, size_t inend,
                        unsigned char* bp, unsigned char** out,
                        size_t* outsize) {
-  size_t i;
-  /* byte coordinates rather than lz77 index */
-  size_t* splitpoints_uncompressed = 0;
   size_t npoints = 0;
   size_t* splitpoints = 0;
-  double totalcost = 0;
   ZopfliLZ77Store lz77;
 
   /* If btype=2 is specified, it tries all block types. If a lesser btype is
@@ -841,69 +972,72 @@ void ZopfliDeflatePart(const ZopfliOptions* options, int btype, int final,
     return;
   }
 
-
-  if (options->blocksplitting) {
-    ZopfliBlockSplit(options, in, instart, inend,
-                     options->blocksplittingmax,
-                     &splitpoints_uncompressed, &npoints);
-    splitpoints = (size_t*)malloc(sizeof(*splitpoints) * npoints);
-  }
-
   ZopfliInitLZ77Store(in, &lz77);
+  DeflatePartLZ77(options, in, instart, inend, &lz77, &splitpoints, &npoints);
+  AddLZ77Blocks(options, final, &lz77, splitpoints, npoints,
+                bp, out, outsize);
 
-  for (i = 0; i <= npoints; i++) {
-    size_t start = i == 0 ? instart : splitpoints_uncompressed[i - 1];
-    size_t end = i == npoints ? inend : splitpoints_uncompressed[i];
-    ZopfliBlockState s;
-    ZopfliLZ77Store store;
-    ZopfliInitLZ77Store(in, &store);
-    ZopfliInitBlockState(options, start, end, 1, &s);
-    ZopfliLZ77Optimal(&s, in, start, end, options->numiterations, &store);
-    totalcost += ZopfliCalculateBlockSizeAutoType(&store, 0, store.size);
+  ZopfliCleanLZ77Store(&lz77);
+  free(splitpoints);
+}
 
-    ZopfliAppendLZ77Store(&store, &lz77);
-    if (i < npoints) splitpoints[i] = lz77.size;
+#if ZOPFLI_MASTER_BLOCK_SIZE != 0
+/* Input and results of the LZ77 optimization of all master blocks. */
+typedef struct MasterJobs {
+  const ZopfliOptions* options;
+  const unsigned char* in;
+  size_t insize;
+  ZopfliLZ77Store* stores;
+  size_t** splitpoints;
+  size_t* npoints;
+} MasterJobs;
+
+static void OptimizeMasterBlock(void* context, size_t i) {
+  MasterJobs* jobs = (MasterJobs*)context;
+  size_t start = i * ZOPFLI_MASTER_BLOCK_SIZE;
+  size_t end = start + ZOPFLI_MASTER_BLOCK_SIZE;
+  if (end > jobs->insize) end = jobs->insize;
+  ZopfliInitLZ77Store(jobs->in, &jobs->stores[i]);
+  DeflatePartLZ77(jobs->options, jobs->in, start, end, &jobs->stores[i],
+                  &jobs->splitpoints[i], &jobs->npoints[i]);
+}
 
-    ZopfliCleanBlockState(&s);
-    ZopfliCleanLZ77Store(&store);
+/*
+Like the master block loop of ZopfliDeflate, but optimizes all master blocks
+concurrently before writing them in order.
+*/
+static void DeflateMasterBlocks(const ZopfliOptions* options, int final,
+                                const unsigned char* in, size_t insize,
+                                unsigned char* bp,
+                                unsigned char** out, size_t* outsize) {
+  size_t i;
+  size_t count = (insize + ZOPFLI_MASTER_BLOCK_SIZE - 1)
+      / ZOPFLI_MASTER_BLOCK_SIZE;
+  MasterJobs jobs;
+  jobs.options = options;
+  jobs.in = in;
+  jobs.insize = insize;
+  jobs.stores = (ZopfliLZ77Store*)malloc(sizeof(*jobs.stores) * count);
+  jobs.splitpoints = (size_t**)malloc(sizeof(*jobs.splitpoints) * count);
+  jobs.npoints = (size_t*)malloc(sizeof(*jobs.npoints) * count);
+  if (!jobs.stores || !jobs.splitpoints || !jobs.npoints) {
+    exit(-1); /* Allocation failed. */
   }
 
-  /* Second block splitting attempt */
-  if (options->blocksplitting && npoints > 1) {
-    size_t* splitpoints2 = 0;
-    size_t npoints2 = 0;
-    double totalcost2 = 0;
-
-    ZopfliBlockSplitLZ77(options, &lz77,
-                         options->blocksplittingmax, &splitpoints2, &npoints2);
-
-    for (i = 0; i <= npoints2; i++) {
-      size_t start = i == 0 ? 0 : splitpoints2[i - 1];
-      size_t end = i == npoints2 ? lz77.size : splitpoints2[i];
-      totalcost2 += ZopfliCalculateBlockSizeAutoType(&lz77, start, end);
-    }
-
-    if (totalcost2 < totalcost) {
-      free(splitpoints);
-      splitpoints = splitpoints2;
-      npoints = npoints2;
-    } else {
-      free(splitpoints2);
-    }
-  }
+  RunJobs(options, count, OptimizeMasterBlock, &jobs);
 
-  for (i = 0; i <= npoints; i++) {
-    size_t start = i == 0 ? 0 : splitpoints[i - 1];
-    size_t end = i == npoints ? lz77.size : splitpoints[i];
-    AddLZ77BlockAutoType(options, i == npoints && final,
-                         &lz77, start, end, 0,
-                         bp, out, outsize);
+  for (i = 0; i < count; i++) {
+    AddLZ77Blocks(options, final && i + 1 == count, &jobs.stores[i],
+                  jobs.splitpoints[i], jobs.npoints[i], bp, out, outsize);
+    ZopfliCleanLZ77Store(&jobs.stores[i]);
+    free(jobs.splitpoints[i]);
   }
 
-  ZopfliCleanLZ77Store(&lz77);
-  free(splitpoints);
-  free(splitpoints_uncompressed);
+  free(jobs.stores);
+  free(jobs.splitpoints);
+  free(jobs.npoints);
 }
+#endif
 
 void ZopfliDeflate(const ZopfliOptions* options, int btype, int final,
                    const unsigned char* in, size_t insize,
@@ -913,7 +1047,10 @@ void ZopfliDeflate(const ZopfliOptions* options, int btype, int final,
   ZopfliDeflatePart(options, btype, final, in, 0, insize, bp, out, outsize);
 #else
   size_t i = 0;
-  do {
+  if (options->parallel_for && btype == 2
+      && insize > ZOPFLI_MASTER_BLOCK_SIZE) {
+    DeflateMasterBlocks(options, final, in, insize, bp, out, outsize);
+  } else do {
     int masterfinal = (i + ZOPFLI_MASTER_BLOCK_SIZE >= insize);
     int final2 = final && masterfinal;
     size_t size = masterfinal ? insize - i : ZOPFLI_MASTER_BLOCK_SIZE;
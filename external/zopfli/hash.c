@@ -18,6 +18,7 @@ Author: jyrki.alakuijala@gmail.com (Jyrki Alakuijala)
 */
 
 #include "hash.h"
+#include "arena.h"
 
 #include <assert.h>
 #include <stdio.h>
@@ -27,18 +28,19 @@ Author: jyrki.alakuijala@gmail.com (Jyrki Alakuijala)
 #define HASH_MASK 32767
 
 void ZopfliAllocHash(size_t window_size, ZopfliHash* h) {
-  h->head = (int*)malloc(sizeof(*h->head) * 65536);
-  h->prev = (unsigned short*)malloc(sizeof(*h->prev) * window_size);
-  h->hashval = (int*)malloc(sizeof(*h->hashval) * window_size);
+  h->head = (int*)ZopfliArenaMalloc(sizeof(*h->head) * 65536);
+  h->prev = (unsigned short*)ZopfliArenaMalloc(sizeof(*h->prev) * window_size);
+  h->hashval = (int*)ZopfliArenaMalloc(sizeof(*h->hashval) * window_size);
 
 #ifdef ZOPFLI_HASH_SAME
-  h->same = (unsigned short*)malloc(sizeof(*h->same) * window_size);
+  h->same = (unsigned short*)ZopfliArenaMalloc(sizeof(*h->same) * window_size);
 #endif
 
 #ifdef ZOPFLI_HASH_SAME_HASH
-  h->head2 = (int*)malloc(sizeof(*h->head2) * 65536);
-  h->prev2 = (unsigned short*)malloc(sizeof(*h->prev2) * window_size);
-  h->hashval2 = (int*)malloc(sizeof(*h->hashval2) * window_size);
+  h->head2 = (int*)ZopfliArenaMalloc(sizeof(*h->head2) * 65536);
+  h->prev2 =
+      (unsigned short*)ZopfliArenaMalloc(sizeof(*h->prev2) * window_size);
+  h->hashval2 = (int*)ZopfliArenaMalloc(sizeof(*h->hashval2) * window_size);
 #endif
 }
 
@@ -73,18 +75,18 @@ void ZopfliResetHash(size_t window_size, ZopfliHash* h) {
 }
 
 void ZopfliCleanHash(ZopfliHash* h) {
-  free(h->head);
-  free(h->prev);
-  free(h->hashval);
+  ZopfliArenaFree(h->head);
+  ZopfliArenaFree(h->prev);
+  ZopfliArenaFree(h->hashval);
 
 #ifdef ZOPFLI_HASH_SAME_HASH
-  free(h->head2);
-  free(h->prev2);
-  free(h->hashval2);
+  ZopfliArenaFree(h->head2);
+  ZopfliArenaFree(h->prev2);
+  ZopfliArenaFree(h->hashval2);
 #endif
 
 #ifdef ZOPFLI_HASH_SAME
-  free(h->same);
+  ZopfliArenaFree(h->same);
 #endif
 }
 
@@ -18,6 +18,8 @@ Author: jyrki.alakuijala@gmail.com (Jyrki Alakuijala)
 */
 
 #include "lz77.h"
+#include "arena.h"
+#include "match.h"
 #include "symbols.h"
 #include "util.h"
 
@@ -38,13 +40,13 @@ void ZopfliInitLZ77Store(const unsigned char* data, ZopfliLZ77Store* store) {
 }
 
 void ZopfliCleanLZ77Store(ZopfliLZ77Store* store) {
-  free(store->litlens);
-  free(store->dists);
-  free(store->pos);
-  free(store->ll_symbol);
-  free(store->d_symbol);
-  free(store->ll_counts);
-  free(store->d_counts);
+  ZopfliArenaFree(store->litlens);
+  ZopfliArenaFree(store->dists);
+  ZopfliArenaFree(store->pos);
+  ZopfliArenaFree(store->ll_symbol);
+  ZopfliArenaFree(store->d_symbol);
+  ZopfliArenaFree(store->ll_counts);
+  ZopfliArenaFree(store->d_counts);
 }
 
 static size_t CeilDiv(size_t a, size_t b) {
@@ -59,15 +61,19 @@ void ZopfliCopyLZ77Store(
   ZopfliCleanLZ77Store(dest);
   ZopfliInitLZ77Store(source->data, dest);
   dest->litlens =
-      (unsigned short*)malloc(sizeof(*dest->litlens) * source->size);
-  dest->dists = (unsigned short*)malloc(sizeof(*dest->dists) * source->size);
-  dest->pos = (size_t*)malloc(sizeof(*dest->pos) * source->size);
+      (unsigned short*)ZopfliArenaMalloc(sizeof(*dest->litlens) * source->size);
+  dest->dists =
+      (unsigned short*)ZopfliArenaMalloc(sizeof(*dest->dists) * source->size);
+  dest->pos = (size_t*)ZopfliArenaMalloc(sizeof(*dest->pos) * source->size);
   dest->ll_symbol =
-      (unsigned short*)malloc(sizeof(*dest->ll_symbol) * source->size);
+      (unsigned short*)ZopfliArenaMalloc(
+          sizeof(*dest->ll_symbol) * source->size);
   dest->d_symbol =
-      (unsigned short*)malloc(sizeof(*dest->d_symbol) * source->size);
-  dest->ll_counts = (size_t*)malloc(sizeof(*dest->ll_counts) * llsize);
-  dest->d_counts = (size_t*)malloc(sizeof(*dest->d_counts) * dsize);
+      (unsigned short*)ZopfliArenaMalloc(
+          sizeof(*dest->d_symbol) * source->size);
+  dest->ll_counts =
+      (size_t*)ZopfliArenaMalloc(sizeof(*dest->ll_counts) * llsize);
+  dest->d_counts = (size_t*)ZopfliArenaMalloc(sizeof(*dest->d_counts) * dsize);
 
   /* Allocation failed. */
   if (!dest->litlens || !dest->dists) exit(-1);
@@ -109,7 +115,7 @@ void ZopfliStoreLitLenDist(unsigned short length, unsigned short dist,
   if (origsize % ZOPFLI_NUM_LL == 0) {
     size_t llsize = origsize;
     for (i = 0; i < ZOPFLI_NUM_LL; i++) {
-      ZOPFLI_APPEND_DATA(
+      ZOPFLI_ARENA_APPEND_DATA(
           origsize == 0 ? 0 : store->ll_counts[origsize - ZOPFLI_NUM_LL + i],
           &store->ll_counts, &llsize);
     }
@@ -117,31 +123,31 @@ void ZopfliStoreLitLenDist(unsigned short length, unsigned short dist,
   if (origsize % ZOPFLI_NUM_D == 0) {
     size_t dsize = origsize;
     for (i = 0; i < ZOPFLI_NUM_D; i++) {
-      ZOPFLI_APPEND_DATA(
+      ZOPFLI_ARENA_APPEND_DATA(
           origsize == 0 ? 0 : store->d_counts[origsize - ZOPFLI_NUM_D + i],
           &store->d_counts, &dsize);
     }
   }
 
-  ZOPFLI_APPEND_DATA(length, &store->litlens, &store->size);
+  ZOPFLI_ARENA_APPEND_DATA(length, &store->litlens, &store->size);
   store->size = origsize;
-  ZOPFLI_APPEND_DATA(dist, &store->dists, &store->size);
+  ZOPFLI_ARENA_APPEND_DATA(dist, &store->dists, &store->size);
   store->size = origsize;
-  ZOPFLI_APPEND_DATA(pos, &store->pos, &store->size);
+  ZOPFLI_ARENA_APPEND_DATA(pos, &store->pos, &store->size);
   assert(length < 259);
 
   if (dist == 0) {
     store->size = origsize;
-    ZOPFLI_APPEND_DATA(length, &store->ll_symbol, &store->size);
+    ZOPFLI_ARENA_APPEND_DATA(length, &store->ll_symbol, &store->size);
     store->size = origsize;
-    ZOPFLI_APPEND_DATA(0, &store->d_symbol, &store->size);
+    ZOPFLI_ARENA_APPEND_DATA(0, &store->d_symbol, &store->size);
     store->ll_counts[llstart + length]++;
   } else {
     store->size = origsize;
-    ZOPFLI_APPEND_DATA(ZopfliGetLengthSymbol(length),
+    ZOPFLI_ARENA_APPEND_DATA(ZopfliGetLengthSymbol(length),
                        &store->ll_symbol, &store->size);
     store->size = origsize;
-    ZOPFLI_APPEND_DATA(ZopfliGetDistSymbol(dist),
+    ZOPFLI_ARENA_APPEND_DATA(ZopfliGetDistSymbol(dist),
                        &store->d_symbol, &store->size);
     store->ll_counts[llstart + ZopfliGetLengthSymbol(length)]++;
     store->d_counts[dstart + ZopfliGetDistSymbol(dist)]++;
@@ -224,7 +230,8 @@ void ZopfliInitBlockState(const ZopfliOptions* options,
   s->blockend = blockend;
 #ifdef ZOPFLI_LONGEST_MATCH_CACHE
   if (add_lmc) {
-    s->lmc = (ZopfliLongestMatchCache*)malloc(sizeof(ZopfliLongestMatchCache));
+    s->lmc = (ZopfliLongestMatchCache*)ZopfliArenaMalloc(
+        sizeof(ZopfliLongestMatchCache));
     ZopfliInitCache(blockend - blockstart, s->lmc);
   } else {
     s->lmc = 0;
@@ -236,7 +243,7 @@ void ZopfliCleanBlockState(ZopfliBlockState* s) {
 #ifdef ZOPFLI_LONGEST_MATCH_CACHE
   if (s->lmc) {
     ZopfliCleanCache(s->lmc);
-    free(s->lmc);
+    ZopfliArenaFree(s->lmc);
   }
 #endif
 }
@@ -285,51 +292,6 @@ void ZopfliVerifyLenDist(const unsigned char* data, size_t datasize, size_t pos,
   }
 }
 
-/*
-Finds how long the match of scan and match is. Can be used to find how many
-bytes starting from scan, and from match, are equal. Returns the last byte
-after scan, which is still equal to the correspondinb byte after match.
-scan is the position to compare
-match is the earlier position to compare.
-end is the last possible byte, beyond which to stop looking.
-safe_end is a few (8) bytes before end, for comparing multiple bytes at once.
-*/
-static const unsigned char* GetMatch(const unsigned char* scan,
-                                     const unsigned char* match,
-                                     const unsigned char* end,
-                                     const unsigned char* safe_end) {
-
-  if (sizeof(size_t) == 8) {
-    /* 8 checks at once per array bounds check (size_t is 64-bit). */
-    while (scan < safe_end && *((size_t*)scan) == *((size_t*)match)) {
-      scan += 8;
-      match += 8;
-    }
-  } else if (sizeof(unsigned int) == 4) {
-    /* 4 checks at once per array bounds check (unsigned int is 32-bit). */
-    while (scan < safe_end
-        && *((unsigned int*)scan) == *((unsigned int*)match)) {
-      scan += 4;
-      match += 4;
-    }
-  } else {
-    /* do 8 checks at once per array bounds check. */
-    while (scan < safe_end && *scan == *match && *++scan == *++match
-          && *++scan == *++match && *++scan == *++match
-          && *++scan == *++match && *++scan == *++match
-          && *++scan == *++match && *++scan == *++match) {
-      scan++; match++;
-    }
-  }
-
-  /* The remaining few bytes. */
-  while (scan != end && *scan == *match) {
-    scan++; match++;
-  }
-
-  return scan;
-}
-
 #ifdef ZOPFLI_LONGEST_MATCH_CACHE
 /*
 Gets distance, length and sublen values from the cache if possible.
@@ -0,0 +1,136 @@
+/*
+Copyright 2011 Google Inc. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+Author: lode.vandevenne@gmail.com (Lode Vandevenne)
+Author: jyrki.alakuijala@gmail.com (Jyrki Alakuijala)
+*/
+
+/*
+The match length search of the LZ77 hash chain walk. It is in a header, so
+lz77.c can inline it and the match benchmark of xyzcrush can time the scalar
+and the SSE2 variant against each other.
+
+Vectorized match length search on x86. SSE2 is used when the compiler targets
+it anyway (always on x86-64), so no runtime dispatch is needed. An AVX2 kernel
+measured slower on XYZ data, where most matches end within 16 bytes.
+*/
+
+#ifndef ZOPFLI_MATCH_H_
+#define ZOPFLI_MATCH_H_
+
+#include <stddef.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) \
+    || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ZOPFLI_SSE2
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+/*
+Finds how long the match of scan and match is. Can be used to find how many
+bytes starting from scan, and from match, are equal. Returns the last byte
+after scan, which is still equal to the correspondinb byte after match.
+scan is the position to compare
+match is the earlier position to compare.
+end is the last possible byte, beyond which to stop looking.
+safe_end is a few (8) bytes before end, for comparing multiple bytes at once.
+*/
+static const unsigned char* GetMatchScalar(const unsigned char* scan,
+                                           const unsigned char* match,
+                                           const unsigned char* end,
+                                           const unsigned char* safe_end) {
+
+  if (sizeof(size_t) == 8) {
+    /* 8 checks at once per array bounds check (size_t is 64-bit). */
+    while (scan < safe_end && *((size_t*)scan) == *((size_t*)match)) {
+      scan += 8;
+      match += 8;
+    }
+  } else if (sizeof(unsigned int) == 4) {
+    /* 4 checks at once per array bounds check (unsigned int is 32-bit). */
+    while (scan < safe_end
+        && *((unsigned int*)scan) == *((unsigned int*)match)) {
+      scan += 4;
+      match += 4;
+    }
+  } else {
+    /* do 8 checks at once per array bounds check. */
+    while (scan < safe_end && *scan == *match && *++scan == *++match
+          && *++scan == *++match && *++scan == *++match
+          && *++scan == *++match && *++scan == *++match
+          && *++scan == *++match && *++scan == *++match) {
+      scan++; match++;
+    }
+  }
+
+  /* The remaining few bytes. */
+  while (scan != end && *scan == *match) {
+    scan++; match++;
+  }
+
+  return scan;
+}
+
+#ifdef ZOPFLI_SSE2
+/* Index of the lowest set bit, mask must not be 0. */
+static int CountTrailingZeros(unsigned mask) {
+#ifdef _MSC_VER
+  unsigned long index;
+  _BitScanForward(&index, mask);
+  return (int)index;
+#else
+  return __builtin_ctz(mask);
+#endif
+}
+
+/* Same as GetMatchScalar, compares 16 bytes per step. */
+static const unsigned char* GetMatchSSE2(const unsigned char* scan,
+                                         const unsigned char* match,
+                                         const unsigned char* end,
+                                         const unsigned char* safe_end) {
+  while (end - scan >= 16) {
+    __m128i a = _mm_loadu_si128((const __m128i*)scan);
+    __m128i b = _mm_loadu_si128((const __m128i*)match);
+    unsigned equal = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(a, b));
+    if (equal != 0xFFFFu) {
+      return scan + CountTrailingZeros(~equal);
+    }
+    scan += 16;
+    match += 16;
+  }
+
+  return GetMatchScalar(scan, match, end, safe_end);
+}
+#endif
+
+/*
+Finds how long the match of scan and match is, see GetMatchScalar. Both
+variants return the same position, so the output does not depend on the CPU.
+*/
+static const unsigned char* GetMatch(const unsigned char* scan,
+                                     const unsigned char* match,
+                                     const unsigned char* end,
+                                     const unsigned char* safe_end) {
+#ifdef ZOPFLI_SSE2
+  return GetMatchSSE2(scan, match, end, safe_end);
+#else
+  return GetMatchScalar(scan, match, end, safe_end);
+#endif
+}
+
+#endif  /* ZOPFLI_MATCH_H_ */
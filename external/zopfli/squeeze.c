@@ -23,6 +23,7 @@ Author: jyrki.alakuijala@gmail.com (Jyrki Alakuijala)
 #include <math.h>
 #include <stdio.h>
 
+#include "arena.h"
 #include "blocksplitter.h"
 #include "deflate.h"
 #include "symbols.h"
@@ -450,7 +451,8 @@ void ZopfliLZ77Optimal(ZopfliBlockState *s,
   /* Dist to get to here with smallest cost. */
   size_t blocksize = inend - instart;
   unsigned short* length_array =
-      (unsigned short*)malloc(sizeof(unsigned short) * (blocksize + 1));
+      (unsigned short*)ZopfliArenaMalloc(
+          sizeof(unsigned short) * (blocksize + 1));
   unsigned short* path = 0;
   size_t pathsize = 0;
   ZopfliLZ77Store currentstore;
@@ -458,13 +460,14 @@ void ZopfliLZ77Optimal(ZopfliBlockState *s,
   ZopfliHash* h = &hash;
   SymbolStats stats, beststats, laststats;
   int i;
-  float* costs = (float*)malloc(sizeof(float) * (blocksize + 1));
+  float* costs = (float*)ZopfliArenaMalloc(sizeof(float) * (blocksize + 1));
   double cost;
   double bestcost = ZOPFLI_LARGE_FLOAT;
   double lastcost = 0;
   /* Try randomizing the costs a bit once the size stabilizes. */
   RanState ran_state;
   int lastrandomstep = -1;
+  int lastimprovement = 0;
 
   if (!costs) exit(-1); /* Allocation failed. */
   if (!length_array) exit(-1); /* Allocation failed. */
@@ -484,6 +487,17 @@ void ZopfliLZ77Optimal(ZopfliBlockState *s,
   /* Repeat statistics with each time the cost model from the previous stat
   run. */
   for (i = 0; i < numiterations; i++) {
+    /* The first iteration always runs, it fills the output store. */
+    if (i > 0) {
+      if (s->options->stagnation > 0
+          && i - lastimprovement >= s->options->stagnation) {
+        break;
+      }
+      if (s->options->should_stop
+          && s->options->should_stop(s->options->stop_opaque)) {
+        break;
+      }
+    }
     ZopfliCleanLZ77Store(&currentstore);
     ZopfliInitLZ77Store(in, &currentstore);
     LZ77OptimalRun(s, in, instart, inend, &path, &pathsize,
@@ -498,6 +512,7 @@ void ZopfliLZ77Optimal(ZopfliBlockState *s,
       ZopfliCopyLZ77Store(&currentstore, store);
       CopyStats(&stats, &beststats);
       bestcost = cost;
+      lastimprovement = i;
     }
     CopyStats(&stats, &laststats);
     ClearStatFreqs(&stats);
@@ -518,9 +533,9 @@ void ZopfliLZ77Optimal(ZopfliBlockState *s,
     lastcost = cost;
   }
 
-  free(length_array);
+  ZopfliArenaFree(length_array);
   free(path);
-  free(costs);
+  ZopfliArenaFree(costs);
   ZopfliCleanLZ77Store(&currentstore);
   ZopfliCleanHash(h);
 }
@@ -533,12 +548,13 @@ void ZopfliLZ77OptimalFixed(ZopfliBlockState *s,
   /* Dist to get to here with smallest cost. */
   size_t blocksize = inend - instart;
   unsigned short* length_array =
-      (unsigned short*)malloc(sizeof(unsigned short) * (blocksize + 1));
+      (unsigned short*)ZopfliArenaMalloc(
+          sizeof(unsigned short) * (blocksize + 1));
   unsigned short* path = 0;
   size_t pathsize = 0;
   ZopfliHash hash;
   ZopfliHash* h = &hash;
-  float* costs = (float*)malloc(sizeof(float) * (blocksize + 1));
+  float* costs = (float*)ZopfliArenaMalloc(sizeof(float) * (blocksize + 1));
 
   if (!costs) exit(-1); /* Allocation failed. */
   if (!length_array) exit(-1); /* Allocation failed. */
@@ -553,8 +569,8 @@ void ZopfliLZ77OptimalFixed(ZopfliBlockState *s,
   LZ77OptimalRun(s, in, instart, inend, &path, &pathsize,
                  length_array, GetCostFixed, 0, store, h, costs);
 
-  free(length_array);
+  ZopfliArenaFree(length_array);
   free(path);
-  free(costs);
+  ZopfliArenaFree(costs);
   ZopfliCleanHash(h);
 }
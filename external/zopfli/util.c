@@ -32,4 +32,9 @@ void ZopfliInitOptions(ZopfliOptions* options) {
   options->blocksplitting = 1;
   options->blocksplittinglast = 0;
   options->blocksplittingmax = 15;
+  options->parallel_for = 0;
+  options->parallel_opaque = 0;
+  options->stagnation = 0;
+  options->should_stop = 0;
+  options->stop_opaque = 0;
 }
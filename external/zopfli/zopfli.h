@@ -61,6 +61,36 @@ typedef struct ZopfliOptions {
   extreme results that hurt compression on some files). Default value: 15.
   */
   int blocksplittingmax;
+
+  /*
+  Optional hook to run independent work concurrently: the LZ77 optimization of
+  the blocks found by block splitting and of the master blocks. It must call
+  job(context, i) exactly once for every i in [0, count) and only return when
+  all calls finished. The results do not depend on the order of the calls, so
+  the output is identical to the serial one. Default: 0 (run serially).
+  */
+  void (*parallel_for)(void* opaque, size_t count,
+                       void (*job)(void* context, size_t i), void* context);
+
+  /* Passed as first argument to parallel_for. */
+  void* parallel_opaque;
+
+  /*
+  Ends the iterations of a block once the best cost did not improve for this
+  many iterations in a row. Default: 0 (always run numiterations).
+  */
+  int stagnation;
+
+  /*
+  Optional hook to enforce a time limit, called before every iteration but the
+  first. Returning nonzero ends the iterations of the current block, the best
+  result so far is used. It may be called from the threads of parallel_for.
+  Default: 0 (never stop early).
+  */
+  int (*should_stop)(void* opaque);
+
+  /* Passed as argument to should_stop. */
+  void* stop_opaque;
 } ZopfliOptions;
 
 /* Initializes options with default values. */
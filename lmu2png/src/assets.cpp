@@ -0,0 +1,188 @@
+/* assets.cpp, images shared between the maps of a project.
+   Copyright (C) 2026 EasyRPG Project <https://github.com/EasyRPG/>.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+// Headers
+#include <iostream>
+#include "assets.h"
+#include "chipset.h"
+
+namespace {
+	size_t GetBitmapSize(FIBITMAP* dib) {
+		return dib ? static_cast<size_t>(FreeImage_GetPitch(dib)) * FreeImage_GetHeight(dib) : 0;
+	}
+
+	std::shared_ptr<FIBITMAP> MakeShared(FIBITMAP* dib) {
+		return dib ? std::shared_ptr<FIBITMAP>(dib, FIBITMAPDeleter()) : nullptr;
+	}
+}
+
+Assets::Assets() = default;
+
+Assets::~Assets() = default;
+
+Assets& Assets::Instance() {
+	static Assets assets;
+	return assets;
+}
+
+void Assets::SetLimit(size_t bytes) {
+	std::lock_guard<std::mutex> lock(mutex);
+	limit = bytes;
+	Trim();
+}
+
+Assets::Statistics Assets::GetStatistics() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return statistics;
+}
+
+template <typename T, typename F>
+std::shared_ptr<T> Assets::Get(const std::string& key, const std::string& file, F load) {
+	std::filesystem::file_time_type time;
+	if (!file.empty()) {
+		std::error_code ec;
+		time = std::filesystem::last_write_time(file, ec);
+	}
+
+	std::shared_ptr<Entry> entry;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto it = entries.find(key);
+		if (it != entries.end() && it->second->time == time) {
+			statistics.hits++;
+			entry = it->second;
+			order.splice(order.begin(), order, entry->position);
+		} else {
+			statistics.misses++;
+			if (it != entries.end()) {
+				// the file changed
+				if (it->second->counted) {
+					statistics.bytes -= it->second->size;
+				}
+				order.erase(it->second->position);
+				entries.erase(it);
+			}
+
+			entry = std::make_shared<Entry>();
+			entry->time = time;
+			order.push_front(key);
+			entry->position = order.begin();
+			entries[key] = entry;
+		}
+	}
+
+	// other threads wait here until the image is ready
+	std::call_once(entry->once, [&]() {
+		entry->value = load(entry->size);
+	});
+
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it = entries.find(key);
+	if (!entry->counted && it != entries.end() && it->second == entry) {
+		entry->counted = true;
+		statistics.bytes += entry->size;
+		Trim();
+	}
+	return std::static_pointer_cast<T>(entry->value);
+}
+
+void Assets::Trim() {
+	// the most recently used entry always stays
+	while (statistics.bytes > limit && order.size() > 1) {
+		auto it = entries.find(order.back());
+		if (it->second->counted) {
+			statistics.bytes -= it->second->size;
+		}
+		entries.erase(it);
+		order.pop_back();
+		statistics.evictions++;
+	}
+}
+
+std::shared_ptr<Chipset> Assets::GetChipset(const L2IConfig& conf) {
+	return Get<Chipset>("ChipSet:" + conf.chipset, conf.chipset, [&](size_t& size) {
+		std::shared_ptr<Chipset> chipset = LoadChipset(conf);
+		size = chipset->GetMemorySize();
+		return chipset;
+	});
+}
+
+std::shared_ptr<FIBITMAP> Assets::GetCharSet(const std::string& name, bool verbose) {
+	std::string charset{FindResource("CharSet", name)};
+
+	return Get<FIBITMAP>("CharSet:" + (charset.empty() ? "?" + name : charset), charset,
+		[&](size_t& size) -> std::shared_ptr<FIBITMAP> {
+		if (verbose) {
+			std::cerr << "Loading CharSet \"" << name << "\"\n";
+		}
+
+		if (charset.empty()) {
+			std::cout << "Charset \"" << name << "\" not found.\n";
+			return nullptr;
+		}
+		FIBITMAP* image = LoadImage(charset, true);
+		size = GetBitmapSize(image);
+		return MakeShared(image);
+	});
+}
+
+std::shared_ptr<FIBITMAP> Assets::GetPanorama(const std::string& name, bool verbose) {
+	std::string background{FindResource("Panorama", name)};
+
+	return Get<FIBITMAP>("Panorama:" + (background.empty() ? "?" + name : background), background,
+		[&](size_t& size) -> std::shared_ptr<FIBITMAP> {
+		if (verbose) {
+			std::cerr << "Loading Panorama \"" << name << "\"\n";
+		}
+
+		if (background.empty()) {
+			std::cout << "Parallax background \"" << name << "\" not found.\n";
+			return nullptr;
+		}
+		FIBITMAP* image = LoadImage(background);
+		size = GetBitmapSize(image);
+		return MakeShared(image);
+	});
+}
+
+std::shared_ptr<FIBITMAP> Assets::GetScaledPanorama(const std::string& name, int width, int height,
+	bool verbose) {
+	std::shared_ptr<FIBITMAP> panorama = GetPanorama(name, verbose);
+	if (!panorama) {
+		return nullptr;
+	}
+
+	if (height == 0) {
+		height = FreeImage_GetHeight(panorama.get());
+	}
+	if (width == static_cast<int>(FreeImage_GetWidth(panorama.get()))
+		&& height == static_cast<int>(FreeImage_GetHeight(panorama.get()))) {
+		return panorama;
+	}
+
+	std::string background{FindResource("Panorama", name)};
+	std::string key = "Panorama:" + background + "@" + std::to_string(width) + "x" + std::to_string(height);
+
+	return Get<FIBITMAP>(key, background, [&](size_t& size) {
+		if (verbose) {
+			std::cerr << "Scaling Panorama \"" << name << "\" to " << width << "x" << height << "\n";
+		}
+
+		FIBITMAP* scaled = FreeImage_Rescale(panorama.get(), width, height, FILTER_BICUBIC);
+		size = GetBitmapSize(scaled);
+		return MakeShared(scaled);
+	});
+}
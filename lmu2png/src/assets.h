@@ -0,0 +1,128 @@
+/* assets.h, images shared between the maps of a project.
+   Copyright (C) 2026 EasyRPG Project <https://github.com/EasyRPG/>.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#ifndef ASSETS_H
+#define ASSETS_H
+
+// Headers
+#include <cstddef>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "main.h"
+#include "utils.h"
+
+// forward declarations
+
+struct Chipset;
+
+/**
+ * Process-wide cache of decoded chipsets, charsets and panoramas, so maps
+ * rendered in a batch or again in the GUI share them.
+ *
+ * Images are keyed by their file and reloaded when the file changes. When
+ * the decoded images exceed the size limit the least recently used ones are
+ * dropped, the returned pointers keep them alive while they are in use.
+ *
+ * All functions can be called from several threads, every image is loaded
+ * only once. The returned objects must not be modified.
+ */
+class Assets {
+public:
+	// Default limit of the decoded image size
+	static constexpr size_t DEFAULT_LIMIT = 256 * 1024 * 1024;
+
+	struct Statistics {
+		size_t hits;
+		size_t misses;
+		size_t evictions;
+		size_t bytes;
+	};
+
+	Assets();
+	~Assets();
+
+	Assets(const Assets&) = delete;
+	Assets& operator=(const Assets&) = delete;
+
+	/** Returns the cache shared by all renders. */
+	static Assets& Instance();
+
+	/** Sets the size limit in bytes, dropping images when it is exceeded. */
+	void SetLimit(size_t bytes);
+
+	/** Returns the hit and miss counters and the size of the cached images. */
+	Statistics GetStatistics();
+
+	/** Returns the chipset for conf.chipset (empty: a blank one), never nullptr. */
+	std::shared_ptr<Chipset> GetChipset(const L2IConfig& conf);
+
+	/** Returns the CharSet with that name or nullptr when it cannot be loaded. */
+	std::shared_ptr<FIBITMAP> GetCharSet(const std::string& name, bool verbose);
+
+	/** Returns the Panorama with that name or nullptr when it cannot be loaded. */
+	std::shared_ptr<FIBITMAP> GetPanorama(const std::string& name, bool verbose);
+
+	/**
+	 * Returns the Panorama scaled with a bicubic filter, the scaled copy is
+	 * cached separately for every size.
+	 *
+	 * @param name Panorama name
+	 * @param width target width
+	 * @param height target height, 0: keep the height of the image
+	 * @param verbose explain what is being done
+	 * @return scaled image or nullptr when it cannot be loaded
+	 */
+	std::shared_ptr<FIBITMAP> GetScaledPanorama(const std::string& name, int width, int height,
+		bool verbose);
+
+private:
+	struct Entry {
+		std::once_flag once;
+		// type depends on the key
+		std::shared_ptr<void> value;
+		size_t size = 0;
+		// size was added to bytes
+		bool counted = false;
+		std::filesystem::file_time_type time;
+		std::list<std::string>::iterator position;
+	};
+
+	/**
+	 * Finds the entry for the key or calls load to fill a new one.
+	 *
+	 * @param key kind and file of the image
+	 * @param file file whose changes invalidate the entry, can be empty
+	 * @param load creates the value and sets its size
+	 */
+	template <typename T, typename F>
+	std::shared_ptr<T> Get(const std::string& key, const std::string& file, F load);
+
+	/** Drops least recently used entries until the limit is met. */
+	void Trim();
+
+	std::mutex mutex;
+	std::unordered_map<std::string, std::shared_ptr<Entry>> entries;
+	// keys, most recently used first
+	std::list<std::string> order;
+	size_t limit = DEFAULT_LIMIT;
+	Statistics statistics = {};
+};
+
+#endif
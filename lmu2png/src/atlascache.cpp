@@ -0,0 +1,148 @@
+/* atlascache.cpp, on-disk cache of generated chipset atlases.
+   Copyright (C) 2026 EasyRPG Project <https://github.com/EasyRPG/>.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+// Headers
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <system_error>
+#include "atlascache.h"
+#include "chipset.h"
+#include "mappedfile.h"
+#include "tempname.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+	constexpr char entry_magic[4] = { 'L', 'M', 'U', 'A' };
+	// bump when the atlas layout changes
+	constexpr uint8_t entry_version = 1;
+	// keeps the pixels 16 byte aligned inside the mapping
+	constexpr size_t entry_header_size = 16;
+	constexpr size_t entry_pitch = CHIPSET_WIDTH * 4;
+	constexpr size_t entry_size = entry_header_size + entry_pitch * CHIPSET_HEIGHT;
+
+	/** 64 bit FNV-1a, continues from the given hash. */
+	uint64_t Hash(const unsigned char* data, size_t size, uint64_t hash = 14695981039346656037ULL) {
+		for (size_t i = 0; i < size; i++) {
+			hash ^= data[i];
+			hash *= 1099511628211ULL;
+		}
+		return hash;
+	}
+
+	/** Fills the header, the channel order differs between platforms. */
+	void MakeHeader(unsigned char* header) {
+		memset(header, 0, entry_header_size);
+		memcpy(header, entry_magic, 4);
+		header[4] = entry_version;
+		header[5] = FI_RGBA_RED;
+		header[6] = FI_RGBA_ALPHA;
+		header[8] = CHIPSET_WIDTH & 0xFF;
+		header[9] = (CHIPSET_WIDTH >> 8) & 0xFF;
+		header[10] = CHIPSET_HEIGHT & 0xFF;
+		header[11] = (CHIPSET_HEIGHT >> 8) & 0xFF;
+	}
+}
+
+AtlasCache::AtlasCache(std::string directory) : directory(std::move(directory)) {
+}
+
+bool AtlasCache::Init(std::string& error) {
+	std::error_code ec;
+	fs::create_directories(directory, ec);
+	if (ec || !fs::is_directory(directory, ec)) {
+		error = "Cannot use cache directory " + directory + ".";
+		return false;
+	}
+	return true;
+}
+
+std::string AtlasCache::GetEntry(const std::string& chipset_file) const {
+	MappedFile file;
+	if (!file.Open(chipset_file) || file.GetSize() == 0) {
+		return "";
+	}
+
+	unsigned char header[entry_header_size];
+	MakeHeader(header);
+	uint64_t key = Hash(header, entry_header_size);
+	key = Hash(file.GetData(), file.GetSize(), key);
+
+	std::ostringstream ss;
+	ss << directory << "/" << std::hex << std::setw(16) << std::setfill('0') << key << ".atlas";
+	return ss.str();
+}
+
+std::unique_ptr<Chipset> AtlasCache::Lookup(const std::string& entry) const {
+	auto mapping = std::make_unique<MappedFile>();
+	if (!mapping->Open(entry) || mapping->GetSize() != entry_size) {
+		return nullptr;
+	}
+
+	unsigned char header[entry_header_size];
+	MakeHeader(header);
+	if (memcmp(mapping->GetData(), header, entry_header_size) != 0) {
+		return nullptr;
+	}
+
+	// The bitmap only references the mapped pixels, which are never written:
+	// the atlas is only used as a blit source
+	BYTE *bits = const_cast<BYTE *>(mapping->GetData() + entry_header_size);
+	BitmapPtr atlas{FreeImage_ConvertFromRawBitsEx(FALSE, bits, FIT_BITMAP,
+		CHIPSET_WIDTH, CHIPSET_HEIGHT, entry_pitch, 32,
+		FI_RGBA_RED_MASK, FI_RGBA_GREEN_MASK, FI_RGBA_BLUE_MASK, FALSE)};
+	if (!atlas) {
+		return nullptr;
+	}
+
+	return std::make_unique<Chipset>(std::move(atlas), std::move(mapping));
+}
+
+void AtlasCache::Store(const std::string& entry, const Chipset& chipset) const {
+	FIBITMAP *atlas = chipset.GetAtlas();
+	if (FreeImage_GetWidth(atlas) != CHIPSET_WIDTH || FreeImage_GetHeight(atlas) != CHIPSET_HEIGHT
+		|| FreeImage_GetBPP(atlas) != 32) {
+		return;
+	}
+
+	// Write to a private file first, so concurrent runs never see partial entries
+	std::string tmp_path = MakeTempName(entry);
+
+	unsigned char header[entry_header_size];
+	MakeHeader(header);
+
+	std::ofstream file(tmp_path, std::ofstream::binary);
+	file.write(reinterpret_cast<char*>(header), entry_header_size);
+	// FreeImage order: bottom-up scanlines
+	for (int y = 0; y < CHIPSET_HEIGHT; y++) {
+		file.write(reinterpret_cast<char*>(FreeImage_GetScanLine(atlas, y)), entry_pitch);
+	}
+	file.close();
+
+	std::error_code ec;
+	if (!file) {
+		fs::remove(tmp_path, ec);
+		return;
+	}
+	fs::rename(tmp_path, entry, ec);
+	if (ec) {
+		fs::remove(tmp_path, ec);
+	}
+}
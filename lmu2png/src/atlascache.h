@@ -0,0 +1,56 @@
+/* atlascache.h, on-disk cache of generated chipset atlases.
+   Copyright (C) 2026 EasyRPG Project <https://github.com/EasyRPG/>.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#ifndef ATLASCACHE_H
+#define ATLASCACHE_H
+
+// Headers
+#include <memory>
+#include <string>
+
+// forward declarations
+
+struct Chipset;
+
+/**
+ * Keeps the tile atlas generated from a chipset image, so rendering many maps
+ * does not redo the autotile composition every time.
+ *
+ * Entries are addressed by a hash of the chipset file and hold the raw 32 bit
+ * pixels as FreeImage stores them. They are memory mapped on use. A changed
+ * chipset file gets a new entry, unused entries can be deleted at any time.
+ */
+class AtlasCache {
+public:
+	explicit AtlasCache(std::string directory);
+
+	/** Creates the cache directory when needed, returns false on error. */
+	bool Init(std::string& error);
+
+	/** Returns the entry path for a chipset image, empty when it cannot be read. */
+	std::string GetEntry(const std::string& chipset_file) const;
+
+	/** Returns the chipset stored in the entry or nullptr. */
+	std::unique_ptr<Chipset> Lookup(const std::string& entry) const;
+
+	/** Records the atlas of the chipset, replacing an older entry. */
+	void Store(const std::string& entry, const Chipset& chipset) const;
+
+private:
+	std::string directory;
+};
+
+#endif
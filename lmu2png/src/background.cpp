@@ -0,0 +1,134 @@
+/* background.cpp, map background drawn band by band.
+   Copyright (C) 2026 EasyRPG Project <https://github.com/EasyRPG/>.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+// Headers
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "background.h"
+
+namespace {
+	// Mitchell-Netravali filter with B = C = 1/3, the bicubic filter of FreeImage
+	double Bicubic(double x) {
+		x = std::fabs(x);
+		if (x < 1.0) {
+			return (7.0 * x * x * x - 12.0 * x * x + 16.0 / 3.0) / 6.0;
+		}
+		if (x < 2.0) {
+			return (-7.0 / 3.0 * x * x * x + 12.0 * x * x - 20.0 * x + 32.0 / 3.0) / 6.0;
+		}
+		return 0.0;
+	}
+}
+
+Background::Background(int width, int height) : width(width), height(height) {
+}
+
+void Background::SetColor(const RGBQUAD& color) {
+	this->color = color;
+	panorama.reset();
+	panorama_view = BlitSurface();
+}
+
+bool Background::SetPanorama(std::shared_ptr<FIBITMAP> image) {
+	BlitSurface view(image.get());
+	if (!view.top || view.width != width || view.height <= 0) {
+		return false;
+	}
+
+	panorama = std::move(image);
+	panorama_view = view;
+	tiled = false;
+	return true;
+}
+
+bool Background::SetTiledPanorama(std::shared_ptr<FIBITMAP> image) {
+	BlitSurface view(image.get());
+	if (!view.top || view.width <= 0 || view.height <= 0) {
+		return false;
+	}
+
+	panorama = std::move(image);
+	panorama_view = view;
+	tiled = true;
+	return true;
+}
+
+void Background::DrawBand(const BlitSurface& band, int top) const {
+	if (!panorama) {
+		for (int y = 0; y < band.height; y++) {
+			BYTE *row = band.At(0, y);
+			for (int x = 0; x < width; x++, row += 4) {
+				row[FI_RGBA_RED] = color.rgbRed;
+				row[FI_RGBA_GREEN] = color.rgbGreen;
+				row[FI_RGBA_BLUE] = color.rgbBlue;
+				row[FI_RGBA_ALPHA] = color.rgbReserved;
+			}
+		}
+		return;
+	}
+
+	if (tiled) {
+		for (int y = 0; y < band.height; y++) {
+			const BYTE *src = panorama_view.At(0, (top + y) % panorama_view.height);
+			BYTE *dst = band.At(0, y);
+			for (int x = 0; x < width; x += panorama_view.width) {
+				memcpy(dst + x * 4, src, std::min(panorama_view.width, width - x) * 4);
+			}
+		}
+		return;
+	}
+
+	int source_height = panorama_view.height;
+	double scale = static_cast<double>(height) / source_height;
+	// Shrinking widens the filter to cover all source rows
+	double filter_scale = std::min(scale, 1.0);
+	double filter_width = 2.0 / filter_scale;
+
+	std::vector<double> weights;
+	std::vector<double> sums(static_cast<size_t>(width) * 4);
+
+	for (int y = 0; y < band.height; y++) {
+		double center = (top + y + 0.5) / scale;
+		int first = std::max(0, static_cast<int>(std::floor(center - filter_width)));
+		int last = std::min(source_height - 1, static_cast<int>(std::ceil(center + filter_width)));
+
+		weights.clear();
+		double total = 0.0;
+		for (int i = first; i <= last; i++) {
+			double weight = Bicubic((i + 0.5 - center) * filter_scale);
+			weights.push_back(weight);
+			total += weight;
+		}
+
+		std::fill(sums.begin(), sums.end(), 0.0);
+		for (int i = first; i <= last; i++) {
+			double weight = weights[i - first] / total;
+			if (weight == 0.0) {
+				continue;
+			}
+			const BYTE *src = panorama_view.At(0, i);
+			for (size_t x = 0; x < sums.size(); x++) {
+				sums[x] += src[x] * weight;
+			}
+		}
+
+		BYTE *dst = band.At(0, y);
+		for (size_t x = 0; x < sums.size(); x++) {
+			dst[x] = static_cast<BYTE>(std::clamp(std::lround(sums[x]), 0L, 255L));
+		}
+	}
+}
@@ -0,0 +1,77 @@
+/* background.h, map background drawn band by band.
+   Copyright (C) 2026 EasyRPG Project <https://github.com/EasyRPG/>.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#ifndef BACKGROUND_H
+#define BACKGROUND_H
+
+// Headers
+#include <memory>
+#include <vector>
+#include <FreeImage.h>
+#include "blit.h"
+#include "utils.h"
+
+/**
+ * Draws the background below the map into bands of rows: transparent, a
+ * color, a Panorama scaled to the map size or a Panorama repeated at its
+ * own size like the engine does.
+ *
+ * A scaled Panorama only has the map width, it is scaled to the map height
+ * for the rows of a band, so the full size copy is never created.
+ */
+class Background {
+public:
+	/** Creates a transparent background for an image of the given size. */
+	Background(int width, int height);
+
+	/** Fills the background with color. */
+	void SetColor(const RGBQUAD& color);
+
+	/**
+	 * Scales a Panorama to the image height with a bicubic filter.
+	 *
+	 * @param panorama 32 bit image already scaled to the image width
+	 * @return false when the image does not fit, the background is kept
+	 */
+	bool SetPanorama(std::shared_ptr<FIBITMAP> panorama);
+
+	/**
+	 * Repeats a Panorama at its own size from the top left corner.
+	 *
+	 * @param panorama 32 bit image
+	 * @return false when the image cannot be used, the background is kept
+	 */
+	bool SetTiledPanorama(std::shared_ptr<FIBITMAP> panorama);
+
+	/**
+	 * Draws the background rows of one band.
+	 *
+	 * @param band surface for the rows, at least as wide as the image
+	 * @param top image row drawn into the first row of band
+	 */
+	void DrawBand(const BlitSurface& band, int top) const;
+
+private:
+	int width;
+	int height;
+	RGBQUAD color = {0, 0, 0, 0};
+	// Panorama at the image width but its own height, or at its own size when tiled
+	std::shared_ptr<FIBITMAP> panorama;
+	BlitSurface panorama_view;
+	bool tiled = false;
+};
+
+#endif
@@ -0,0 +1,234 @@
+/* blit.cpp, alpha keyed copying between 32 bit surfaces.
+   Copyright (C) 2026 EasyRPG Project <https://github.com/EasyRPG/>.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+// Headers
+#include <cstdint>
+#include <cstring>
+#include "blit.h"
+
+// SSE2 is always there on x86-64, AVX2 is picked at runtime
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) \
+	|| (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define BLIT_SSE2
+#	include <emmintrin.h>
+#	if defined(__GNUC__) || defined(__clang__) || defined(_MSC_VER)
+#		define BLIT_AVX2
+#		include <immintrin.h>
+#	endif
+#	ifdef _MSC_VER
+#		include <intrin.h>
+#	endif
+#endif
+
+namespace {
+	using BlitRowFunc = void (*)(const BYTE *src, BYTE *dst, int width);
+
+	void BlitRowScalar(const BYTE *src, BYTE *dst, int width) {
+		for (int x = 0; x < width; x++) {
+			// skip fully transparent pixels
+			if (src[FI_RGBA_ALPHA] != 0) {
+				memcpy(dst, src, 4);
+			}
+			src += 4;
+			dst += 4;
+		}
+	}
+
+#ifdef BLIT_SSE2
+	// x86 is little endian, so this is the alpha byte of a pixel
+	constexpr uint32_t alpha_mask = 0xFFu << (FI_RGBA_ALPHA * 8);
+
+	void BlitRowSSE2(const BYTE *src, BYTE *dst, int width) {
+		const __m128i alpha = _mm_set1_epi32(static_cast<int>(alpha_mask));
+		const __m128i zero = _mm_setzero_si128();
+
+		int x = 0;
+		for (; x + 4 <= width; x += 4) {
+			__m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 4));
+			__m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + x * 4));
+			// all bits set for pixels with alpha 0, these keep the destination
+			__m128i keep = _mm_cmpeq_epi32(_mm_and_si128(s, alpha), zero);
+			d = _mm_or_si128(_mm_and_si128(keep, d), _mm_andnot_si128(keep, s));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), d);
+		}
+		BlitRowScalar(src + x * 4, dst + x * 4, width - x);
+	}
+#endif
+
+#ifdef BLIT_AVX2
+#	if defined(__GNUC__) || defined(__clang__)
+#		define BLIT_TARGET_AVX2 __attribute__((target("avx2")))
+#	else
+#		define BLIT_TARGET_AVX2
+#	endif
+
+	BLIT_TARGET_AVX2
+	void BlitRowAVX2(const BYTE *src, BYTE *dst, int width) {
+		const __m256i alpha = _mm256_set1_epi32(static_cast<int>(alpha_mask));
+		const __m256i zero = _mm256_setzero_si256();
+
+		int x = 0;
+		for (; x + 8 <= width; x += 8) {
+			__m256i s = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x * 4));
+			__m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + x * 4));
+			__m256i keep = _mm256_cmpeq_epi32(_mm256_and_si256(s, alpha), zero);
+			d = _mm256_blendv_epi8(s, d, keep);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x * 4), d);
+		}
+		BlitRowSSE2(src + x * 4, dst + x * 4, width - x);
+	}
+
+	bool HasAVX2() {
+#	ifdef _MSC_VER
+		int info[4];
+		__cpuid(info, 0);
+		if (info[0] < 7) {
+			return false;
+		}
+		__cpuid(info, 1);
+		// OSXSAVE and AVX, then check that the OS saves the YMM registers
+		if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0) {
+			return false;
+		}
+		if ((_xgetbv(0) & 6) != 6) {
+			return false;
+		}
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#	else
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2");
+#	endif
+	}
+#endif
+
+	void CopyRowScalar(const BYTE *src, BYTE *dst, int width, const PixelOrder& order,
+		bool premultiply) {
+		for (int x = 0; x < width; x++) {
+			unsigned int r = src[FI_RGBA_RED];
+			unsigned int g = src[FI_RGBA_GREEN];
+			unsigned int b = src[FI_RGBA_BLUE];
+			unsigned int a = src[FI_RGBA_ALPHA];
+			if (premultiply && a != 255) {
+				r = r * a / 255;
+				g = g * a / 255;
+				b = b * a / 255;
+			}
+			dst[order.red] = static_cast<BYTE>(r);
+			dst[order.green] = static_cast<BYTE>(g);
+			dst[order.blue] = static_cast<BYTE>(b);
+			dst[order.alpha] = static_cast<BYTE>(a);
+			src += 4;
+			dst += 4;
+		}
+	}
+
+#ifdef BLIT_SSE2
+	// Handles buffers in FreeImage order or with the bytes 0 and 2 swapped.
+	// Blocks of opaque or fully transparent pixels need no multiplication,
+	// blocks with translucent pixels go through the scalar path.
+	void CopyRowSSE2(const BYTE *src, BYTE *dst, int width, const PixelOrder& order,
+		bool swap, bool premultiply) {
+		const __m128i alpha = _mm_set1_epi32(static_cast<int>(alpha_mask));
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i low = _mm_set1_epi32(0x000000FF);
+		const __m128i keep = _mm_set1_epi32(static_cast<int>(0xFF00FF00u));
+
+		int x = 0;
+		for (; x + 4 <= width; x += 4) {
+			__m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 4));
+			if (premultiply) {
+				__m128i a = _mm_and_si128(s, alpha);
+				__m128i opaque = _mm_cmpeq_epi32(a, alpha);
+				__m128i clear = _mm_cmpeq_epi32(a, zero);
+				if (_mm_movemask_epi8(_mm_or_si128(opaque, clear)) != 0xFFFF) {
+					CopyRowScalar(src + x * 4, dst + x * 4, 4, order, true);
+					continue;
+				}
+				// transparent pixels become all zero
+				s = _mm_and_si128(s, opaque);
+			}
+			if (swap) {
+				__m128i b0 = _mm_slli_epi32(_mm_and_si128(s, low), 16);
+				__m128i b2 = _mm_and_si128(_mm_srli_epi32(s, 16), low);
+				s = _mm_or_si128(_mm_and_si128(s, keep), _mm_or_si128(b0, b2));
+			}
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), s);
+		}
+		CopyRowScalar(src + x * 4, dst + x * 4, width - x, order, premultiply);
+	}
+#endif
+
+	BlitRowFunc SelectBlitRow() {
+#ifdef BLIT_AVX2
+		if (HasAVX2()) {
+			return BlitRowAVX2;
+		}
+#endif
+#ifdef BLIT_SSE2
+		return BlitRowSSE2;
+#else
+		return BlitRowScalar;
+#endif
+	}
+}
+
+BlitSurface::BlitSurface(FIBITMAP *dib) {
+	if (!dib || FreeImage_GetBPP(dib) != 32 || FreeImage_GetHeight(dib) == 0) {
+		return;
+	}
+
+	width = FreeImage_GetWidth(dib);
+	height = FreeImage_GetHeight(dib);
+	top = FreeImage_GetScanLine(dib, height - 1);
+	stride = -static_cast<std::ptrdiff_t>(FreeImage_GetPitch(dib));
+}
+
+void AlphaKeyBlit(const BlitSurface& src, int sX, int sY, const BlitSurface& dst,
+	int dX, int dY, int width, int height) {
+	static const BlitRowFunc blit_row = SelectBlitRow();
+
+	const BYTE *src_bits = src.At(sX, sY);
+	BYTE *dst_bits = dst.At(dX, dY);
+	for (int y = 0; y < height; y++) {
+		blit_row(src_bits, dst_bits, width);
+		src_bits += src.stride;
+		dst_bits += dst.stride;
+	}
+}
+
+void CopyToBuffer(const BlitSurface& src, BYTE *dst, std::ptrdiff_t dst_stride,
+	const PixelOrder& order, bool premultiply) {
+#ifdef BLIT_SSE2
+	const bool same = order.red == FI_RGBA_RED && order.green == FI_RGBA_GREEN
+		&& order.blue == FI_RGBA_BLUE && order.alpha == FI_RGBA_ALPHA;
+	const bool swap = FI_RGBA_RED + FI_RGBA_BLUE == 2 && order.red == FI_RGBA_BLUE
+		&& order.green == FI_RGBA_GREEN && order.blue == FI_RGBA_RED
+		&& order.alpha == FI_RGBA_ALPHA;
+#endif
+
+	for (int y = 0; y < src.height; y++) {
+		const BYTE *src_bits = src.At(0, y);
+		BYTE *dst_bits = dst + y * dst_stride;
+#ifdef BLIT_SSE2
+		if (same || swap) {
+			CopyRowSSE2(src_bits, dst_bits, src.width, order, swap, premultiply);
+			continue;
+		}
+#endif
+		CopyRowScalar(src_bits, dst_bits, src.width, order, premultiply);
+	}
+}
@@ -0,0 +1,77 @@
+/* blit.h, alpha keyed copying between 32 bit surfaces.
+   Copyright (C) 2026 EasyRPG Project <https://github.com/EasyRPG/>.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#ifndef BLIT_H
+#define BLIT_H
+
+// Headers
+#include <cstddef>
+#include <FreeImage.h>
+
+/**
+ * Pixel layout of a 32 bit FreeImage surface, queried once so that drawing
+ * many tiles does not ask FreeImage for it again.
+ */
+struct BlitSurface {
+	// top left pixel
+	BYTE *top = nullptr;
+	// bytes from a row to the one below it, negative as FreeImage is bottom-up
+	std::ptrdiff_t stride = 0;
+	int width = 0;
+	int height = 0;
+
+	BlitSurface() = default;
+	// surfaces that are not 32 bit stay empty
+	explicit BlitSurface(FIBITMAP *dib);
+
+	BYTE *At(int x, int y) const {
+		return top + y * stride + x * 4;
+	}
+
+	bool Contains(int x, int y, int w, int h) const {
+		return x >= 0 && y >= 0 && w > 0 && h > 0 && x + w <= width && y + h <= height;
+	}
+};
+
+/** Byte positions of the channels in a 32 bit pixel of a foreign buffer. */
+struct PixelOrder {
+	int red;
+	int green;
+	int blue;
+	int alpha;
+};
+
+/**
+ * Copies a rectangle, skipping fully transparent source pixels.
+ * The rectangle must lie inside both surfaces, this is not checked.
+ */
+void AlphaKeyBlit(const BlitSurface& src, int sX, int sY, const BlitSurface& dst,
+	int dX, int dY, int width, int height);
+
+/**
+ * Copies a whole surface into a buffer of the same size in one pass,
+ * reordering the channels and optionally multiplying the colors with alpha.
+ *
+ * @param src surface to copy
+ * @param dst top left pixel of the buffer
+ * @param dst_stride bytes from a buffer row to the one below it
+ * @param order channel positions in the buffer
+ * @param premultiply whether the buffer wants colors multiplied with alpha
+ */
+void CopyToBuffer(const BlitSurface& src, BYTE *dst, std::ptrdiff_t dst_stride,
+	const PixelOrder& order, bool premultiply);
+
+#endif
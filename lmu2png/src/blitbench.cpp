@@ -0,0 +1,142 @@
+/* blitbench.cpp, microbenchmark of the alpha keyed blitter.
+   Copyright (C) 2026 EasyRPG Project <https://github.com/EasyRPG/>.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+// Draws a 40x30 map of 16x16 tiles from a chipset sized surface, once with
+// AlphaKeyBlit and once with the per-pixel loop it replaced, and checks that
+// both produce the same pixels.
+
+// Headers
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "blit.h"
+
+namespace {
+	constexpr int tile_size = 16;
+	constexpr int map_width = 40;
+	constexpr int map_height = 30;
+	constexpr int source_width = 480;
+	constexpr int source_height = 256;
+
+	struct Rect {
+		int sX, sY, dX, dY;
+	};
+
+	// The copy loop lmu2png used before AlphaKeyBlit
+	void ReferenceBlit(const BlitSurface& src, int sX, int sY, const BlitSurface& dst,
+		int dX, int dY, int width, int height) {
+		for (int y = 0; y < height; y++) {
+			const BYTE *src_bits = src.At(sX, sY + y);
+			BYTE *dst_bits = dst.At(dX, dY + y);
+			for (int x = 0; x < width; x++) {
+				if (src_bits[FI_RGBA_ALPHA] != 0) {
+					dst_bits[FI_RGBA_RED] = src_bits[FI_RGBA_RED];
+					dst_bits[FI_RGBA_GREEN] = src_bits[FI_RGBA_GREEN];
+					dst_bits[FI_RGBA_BLUE] = src_bits[FI_RGBA_BLUE];
+					dst_bits[FI_RGBA_ALPHA] = src_bits[FI_RGBA_ALPHA];
+				}
+				src_bits += 4;
+				dst_bits += 4;
+			}
+		}
+	}
+
+	template <typename F>
+	double MeasureMap(int maps, const std::vector<Rect>& tiles, F blit) {
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < maps; i++) {
+			for (const auto& tile : tiles) {
+				blit(tile);
+			}
+		}
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		return elapsed.count() / maps;
+	}
+}
+
+int main(int argc, char** argv) {
+	int maps = argc > 1 ? std::atoi(argv[1]) : 2000;
+	if (maps <= 0) {
+		std::cerr << "Usage: " << argv[0] << " [MAPS]\n";
+		return EXIT_FAILURE;
+	}
+
+	FreeImage_Initialise(false);
+
+	FIBITMAP *source = FreeImage_Allocate(source_width, source_height, 32);
+	FIBITMAP *kernel_out = FreeImage_Allocate(map_width * tile_size, map_height * tile_size, 32);
+	FIBITMAP *reference_out = FreeImage_Allocate(map_width * tile_size, map_height * tile_size, 32);
+	if (!source || !kernel_out || !reference_out) {
+		std::cerr << "Out of memory.\n";
+		return EXIT_FAILURE;
+	}
+
+	BlitSurface src(source);
+	BlitSurface kernel_dst(kernel_out);
+	BlitSurface reference_dst(reference_out);
+
+	// Tiles are a mix of transparent, opaque and partly transparent pixels
+	std::mt19937 rng(1);
+	for (int y = 0; y < src.height; y++) {
+		BYTE *bits = src.At(0, y);
+		for (int x = 0; x < src.width * 4; x++) {
+			bits[x] = static_cast<BYTE>(rng());
+		}
+		for (int x = 0; x < src.width; x++) {
+			unsigned int kind = rng() % 3;
+			bits[x * 4 + FI_RGBA_ALPHA] = kind == 0 ? 0 : kind == 1 ? 255 : bits[x * 4 + FI_RGBA_ALPHA];
+		}
+	}
+
+	std::vector<Rect> tiles;
+	for (int y = 0; y < map_height; y++) {
+		for (int x = 0; x < map_width; x++) {
+			tiles.push_back({
+				static_cast<int>(rng() % (source_width / tile_size)) * tile_size,
+				static_cast<int>(rng() % (source_height / tile_size)) * tile_size,
+				x * tile_size, y * tile_size });
+		}
+	}
+
+	double reference_ms = MeasureMap(maps, tiles, [&](const Rect& r) {
+		ReferenceBlit(src, r.sX, r.sY, reference_dst, r.dX, r.dY, tile_size, tile_size);
+	});
+	double kernel_ms = MeasureMap(maps, tiles, [&](const Rect& r) {
+		AlphaKeyBlit(src, r.sX, r.sY, kernel_dst, r.dX, r.dY, tile_size, tile_size);
+	});
+
+	bool same = true;
+	for (int y = 0; y < kernel_dst.height; y++) {
+		if (memcmp(kernel_dst.At(0, y), reference_dst.At(0, y), kernel_dst.width * 4) != 0) {
+			same = false;
+		}
+	}
+
+	std::cout << maps << " maps of " << map_width << "x" << map_height << " tiles\n"
+		<< "  per-pixel loop: " << reference_ms << " ms/map\n"
+		<< "  AlphaKeyBlit:   " << kernel_ms << " ms/map\n"
+		<< "  pixels " << (same ? "identical" : "DIFFER") << "\n";
+
+	FreeImage_Unload(source);
+	FreeImage_Unload(kernel_out);
+	FreeImage_Unload(reference_out);
+	FreeImage_DeInitialise();
+
+	return same ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -17,6 +17,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <iostream>
 #include "chipset.h"
 
 #define BIT(x) (1 << (x))
@@ -26,6 +27,8 @@ Chipset::Chipset(FIBITMAP *Surface) {
 	// Set base surface, used for generating the tileset
 	m_Base.reset(FreeImage_Clone(Surface));
 	m_Chipset.reset(FreeImage_Allocate(CHIPSET_WIDTH, CHIPSET_HEIGHT, 32));
+	m_BaseView = BlitSurface(m_Base.get());
+	m_ChipsetView = BlitSurface(m_Chipset.get());
 	int CurrentTile = 0;
 
 	// Generate water tiles A-C
@@ -39,14 +42,14 @@ Chipset::Chipset(FIBITMAP *Surface) {
 
 		for (int frame = 0; frame<3; frame++) {
 			for (int comb = 0; comb<47; comb++, CurrentTile++)
-				RenderWaterTile(m_Chipset.get(), CurrentTile, frame, border, water, comb);
+				RenderWaterTile(m_ChipsetView, CurrentTile, frame, border, water, comb);
 		}
 	}
 
 	// Generate water depth tiles
 	for (int depth = 1; depth<4; depth+=2) {
 		for (int i=0; i<48; i++, CurrentTile++)
-			RenderDepthTile(m_Chipset.get(), CurrentTile, i, depth);
+			RenderDepthTile(m_ChipsetView, CurrentTile, i, depth);
 	}
 
 	// Generate animated tiles
@@ -56,14 +59,14 @@ Chipset::Chipset(FIBITMAP *Surface) {
 			int y = (CurrentTile/TILES_IN_ROW)*TILE_SIZE;
 			int sX = 48+j*TILE_SIZE, sY = 64+i*TILE_SIZE;
 
-			DrawFull(m_Chipset.get(), x, y, sX, sY);
+			DrawFull(m_ChipsetView, x, y, sX, sY);
 		}
 	}
 
 	// Generate terrain tiles
 	for (int terrain=0; terrain<12; terrain++) {
 		for (int comb=0; comb<50; comb++, CurrentTile++)
-			RenderTerrainTile(m_Chipset.get(), CurrentTile, terrain, comb);
+			RenderTerrainTile(m_ChipsetView, CurrentTile, terrain, comb);
 	}
 
 	// Generate common tiles
@@ -73,19 +76,37 @@ Chipset::Chipset(FIBITMAP *Surface) {
 		int sX = 192+((i%6)*TILE_SIZE)+(i/96)*96;
 		int sY = ((i/6)%TILE_SIZE)*TILE_SIZE;
 
-		DrawFull(m_Chipset.get(), x, y, sX, sY);
+		DrawFull(m_ChipsetView, x, y, sX, sY);
 	}
+
+	BuildTileTable();
+}
+
+Chipset::Chipset(BitmapPtr Atlas, std::unique_ptr<MappedFile> Mapping) :
+	m_Mapping(std::move(Mapping)), m_Chipset(std::move(Atlas)), m_ChipsetView(m_Chipset.get()) {
+	BuildTileTable();
 }
 
 Chipset::~Chipset() {
 	//FreeImage_Save(FIF_PNG, m_Chipset.get(), "_chipset.png");
 }
 
-void Chipset::RenderTile(FIBITMAP *dest, int tile_x, int tile_y,
-	unsigned short Tile, int Frame) {
-	tile_x *= TILE_SIZE;
-	tile_y *= TILE_SIZE;
+size_t Chipset::GetMemorySize() const {
+	size_t size = m_TileTable.size() * sizeof(TileRect);
+	for (FIBITMAP *dib : {m_Base.get(), m_Chipset.get()}) {
+		if (dib)
+			size += static_cast<size_t>(FreeImage_GetPitch(dib)) * FreeImage_GetHeight(dib);
+	}
+	return size;
+}
+
+void Chipset::BuildTileTable() {
+	m_TileTable.resize(65536);
+	for (int Tile = 0; Tile < 65536; Tile++)
+		m_TileTable[Tile] = GetTileRect(Tile, 0);
+}
 
+Chipset::TileRect Chipset::GetTileRect(unsigned short Tile, int Frame) {
 	if (Tile >= TILETYPE::UPPER) {               // Upper layer tiles
 		Tile = Tile - TILETYPE::UPPER + 0x04FB;
 	} else if (Tile >= TILETYPE::LOWER) {        // Lower layer tiles
@@ -102,10 +123,25 @@ void Chipset::RenderTile(FIBITMAP *dest, int tile_x, int tile_y,
 		Tile = WaterType*141+WaterTile+(Frame*47);
 	}
 
-	DrawSurface(dest, tile_x, tile_y, ((Tile&0x1F)<<4), ((Tile>>5)<<4), TILE_SIZE, TILE_SIZE, false);
+	int sX = (Tile&0x1F)<<4;
+	int sY = (Tile>>5)<<4;
+	if (sY + TILE_SIZE > CHIPSET_HEIGHT)
+		return {INVALID_TILE, 0};
+	return {static_cast<uint16_t>(sX), static_cast<uint16_t>(sY)};
 }
 
-void Chipset::RenderWaterTile(FIBITMAP *dest, unsigned short Tile, int Frame, int Border, int Water, int Combination) {
+void Chipset::RenderTile(const BlitSurface& dest, int tile_x, int tile_y,
+	unsigned short Tile, int Frame) {
+	TileRect rect = Frame == 0 ? m_TileTable[Tile] : GetTileRect(Tile, Frame);
+	if (rect.x == INVALID_TILE) {
+		std::cout << "Source dimension error.\n";
+		return;
+	}
+
+	DrawSurface(dest, tile_x*TILE_SIZE, tile_y*TILE_SIZE, rect.x, rect.y, TILE_SIZE, TILE_SIZE, false);
+}
+
+void Chipset::RenderWaterTile(const BlitSurface& dest, unsigned short Tile, int Frame, int Border, int Water, int Combination) {
 	int x = (Tile%TILES_IN_ROW)*TILE_SIZE;
 	int y = (Tile/TILES_IN_ROW)*TILE_SIZE;
 	int SFrame = Frame*16, SBorder = Border*48;
@@ -234,7 +270,7 @@ void Chipset::RenderWaterTile(FIBITMAP *dest, unsigned short Tile, int Frame, in
 	}
 }
 
-void Chipset::RenderTerrainTile(FIBITMAP *dest, unsigned short Tile, int Terrain, int Combination) {
+void Chipset::RenderTerrainTile(const BlitSurface& dest, unsigned short Tile, int Terrain, int Combination) {
 	int x = (Tile%TILES_IN_ROW)*TILE_SIZE;
 	int y = (Tile/TILES_IN_ROW)*TILE_SIZE;
 	Terrain += 4;
@@ -362,7 +398,7 @@ void Chipset::RenderTerrainTile(FIBITMAP *dest, unsigned short Tile, int Terrain
 	}
 }
 
-void Chipset::RenderDepthTile(FIBITMAP *dest, unsigned short Tile, int Number, int Depth) {
+void Chipset::RenderDepthTile(const BlitSurface& dest, unsigned short Tile, int Number, int Depth) {
 	int x = (Tile%TILES_IN_ROW)*TILE_SIZE;
 	int y = (Tile/TILES_IN_ROW)*TILE_SIZE;
 	int Frame = Number/16;
@@ -374,34 +410,43 @@ void Chipset::RenderDepthTile(FIBITMAP *dest, unsigned short Tile, int Number, i
 	DrawEdges(dest, x, y, sX, sY, DepthCombination);
 }
 
-void Chipset::DrawSurface(FIBITMAP *dest, int dX, int dY, int sX, int sY, int sW, int sH, bool fromBase) {
-	FIBITMAP* src = fromBase ? m_Base.get() : m_Chipset.get();
+void Chipset::DrawSurface(const BlitSurface& dest, int dX, int dY, int sX, int sY, int sW, int sH, bool fromBase) {
+	const BlitSurface& src = fromBase ? m_BaseView : m_ChipsetView;
 
 	if (sW == -1)
-		sW = FreeImage_GetWidth(src);
+		sW = src.width;
 	if (sH == -1)
-		sH = FreeImage_GetHeight(src);
+		sH = src.height;
+
+	// Tiles never need clipping, so only check the geometry
+	if (!src.Contains(sX, sY, sW, sH)) {
+		std::cout << "Source dimension error.\n";
+		return;
+	}
+	if (!dest.Contains(dX, dY, sW, sH)) {
+		return;
+	}
 
-	CustomAlphaCombine(src, sX, sY, dest, dX, dY, sW, sH);
+	AlphaKeyBlit(src, sX, sY, dest, dX, dY, sW, sH);
 }
 
-inline void Chipset::DrawFull(FIBITMAP *dest, int x, int y, int sX, int sY) {
+inline void Chipset::DrawFull(const BlitSurface& dest, int x, int y, int sX, int sY) {
 	DrawSurface(dest, x, y, sX, sY, TILE_SIZE, TILE_SIZE);
 }
 
-inline void Chipset::DrawQuarter(FIBITMAP *dest, int x, int y, int sX, int sY) {
+inline void Chipset::DrawQuarter(const BlitSurface& dest, int x, int y, int sX, int sY) {
 	DrawSurface(dest, x, y, sX, sY, HALF_TILE, HALF_TILE);
 }
 
-inline void Chipset::DrawWide(FIBITMAP *dest, int x, int y, int sX, int sY) {
+inline void Chipset::DrawWide(const BlitSurface& dest, int x, int y, int sX, int sY) {
 	DrawSurface(dest, x, y, sX, sY, TILE_SIZE, HALF_TILE);
 }
 
-inline void Chipset::DrawTall(FIBITMAP *dest, int x, int y, int sX, int sY) {
+inline void Chipset::DrawTall(const BlitSurface& dest, int x, int y, int sX, int sY) {
 	DrawSurface(dest, x, y, sX, sY, HALF_TILE, TILE_SIZE);
 }
 
-inline void Chipset::DrawEdges(FIBITMAP *dest, int x, int y, int sX, int sY, int Combination) {
+inline void Chipset::DrawEdges(const BlitSurface& dest, int x, int y, int sX, int sY, int Combination) {
 	if (Combination&BIT(0))
 		DrawQuarter(dest, x,           y,           sX,           sY);           // top left
 	if (Combination&BIT(1))
@@ -20,7 +20,12 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
 #include <FreeImage.h>
+#include "blit.h"
+#include "mappedfile.h"
 #include "utils.h"
 
 constexpr int TILE_SIZE=16;
@@ -39,32 +44,56 @@ enum TILETYPE {
 
 // === Chipset structure ===================================================
 struct Chipset {
+	// Position of a tile in the precalculated surface
+	struct TileRect {
+		uint16_t x; // INVALID_TILE for IDs outside of the surface
+		uint16_t y;
+	};
+	static constexpr uint16_t INVALID_TILE = 0xFFFF;
+
 	// --- Fields declaration ----------------------------------------------
 	private:
 		// The chipset structure holds the graphic tileset of a chipset, as well
 		// as their properties and the methods for correctly displaying them.
 		BitmapPtr m_Base;    // Chipset's base surface!
+		std::unique_ptr<MappedFile> m_Mapping; // Cached atlas backing m_Chipset
 		BitmapPtr m_Chipset; // Chipset's precalculated surface
+		BlitSurface m_BaseView;    // Pixel layout of m_Base
+		BlitSurface m_ChipsetView; // Pixel layout of m_Chipset
+		std::vector<TileRect> m_TileTable; // Frame 0 position of every tile ID
 
 	// --- Methods declaration ---------------------------------------------
 	public:
 		Chipset() = delete;
 		explicit Chipset(FIBITMAP *Surface);
+		// Uses a precalculated surface whose pixels live in Mapping
+		Chipset(BitmapPtr Atlas, std::unique_ptr<MappedFile> Mapping);
 		~Chipset();
 
-		void RenderTile(FIBITMAP *dest, int tile_x, int tile_y, unsigned short Tile, int Frame);
-		void RenderWaterTile(FIBITMAP *dest, unsigned short Tile, int Frame, int Border, int Water, int Combination);
-		void RenderDepthTile(FIBITMAP *dest, unsigned short Tile, int Number, int Depth);
-		void RenderTerrainTile(FIBITMAP *dest, unsigned short Tile, int Terrain, int Combination);
-		void DrawSurface(FIBITMAP *dest, int dX, int dY, int sX, int sY, int sW, int sH, bool fromBase = true);
+		FIBITMAP *GetAtlas() const { return m_Chipset.get(); }
+		// Bytes used by the surfaces and the tile table
+		size_t GetMemorySize() const;
+
+		void RenderTile(const BlitSurface& dest, int tile_x, int tile_y, unsigned short Tile, int Frame);
+		// Precalculated surface and frame 0 tile positions for direct blitting
+		const BlitSurface& GetSurface() const { return m_ChipsetView; }
+		const TileRect& LookupTile(unsigned short Tile) const { return m_TileTable[Tile]; }
+
+		void RenderWaterTile(const BlitSurface& dest, unsigned short Tile, int Frame, int Border, int Water, int Combination);
+		void RenderDepthTile(const BlitSurface& dest, unsigned short Tile, int Number, int Depth);
+		void RenderTerrainTile(const BlitSurface& dest, unsigned short Tile, int Terrain, int Combination);
+		void DrawSurface(const BlitSurface& dest, int dX, int dY, int sX, int sY, int sW, int sH, bool fromBase = true);
 
 	private:
+		static TileRect GetTileRect(unsigned short Tile, int Frame);
+		void BuildTileTable();
+
 		// Tile drawing helper functions
-		void DrawFull(FIBITMAP *dest, int x, int y, int sX, int sY);
-		void DrawQuarter(FIBITMAP *dest, int x, int y, int sX, int sY);
-		void DrawWide(FIBITMAP *dest, int x, int y, int sX, int sY);
-		void DrawTall(FIBITMAP *dest, int x, int y, int sX, int sY);
-		void DrawEdges(FIBITMAP *dest, int x, int y, int sX, int sY, int Combination);
+		void DrawFull(const BlitSurface& dest, int x, int y, int sX, int sY);
+		void DrawQuarter(const BlitSurface& dest, int x, int y, int sX, int sY);
+		void DrawWide(const BlitSurface& dest, int x, int y, int sX, int sY);
+		void DrawTall(const BlitSurface& dest, int x, int y, int sX, int sY);
+		void DrawEdges(const BlitSurface& dest, int x, int y, int sX, int sY, int Combination);
 };
 
 #endif
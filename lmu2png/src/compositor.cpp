@@ -0,0 +1,262 @@
+/* compositor.cpp, draw lists for the layers of a map.
+   Copyright (C) 2026 EasyRPG Project <https://github.com/EasyRPG/>.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+// Headers
+#include <algorithm>
+#include <iostream>
+#include "compositor.h"
+#include "assets.h"
+#include "jobpool.h"
+
+Compositor::Compositor(const Chipset& chipset, const L2IConfig& conf) :
+	chipset(chipset), conf(conf), built(conf) {
+}
+
+void Compositor::Build(const lcf::rpg::Map& map, const uint8_t* csflag, Assets& assets) {
+	width = map.width * TILE_SIZE;
+	height = map.height * TILE_SIZE;
+	for (auto& source : tiles) {
+		for (auto& list : source) {
+			list.clear();
+		}
+	}
+	for (auto& list : sprites) {
+		list.clear();
+	}
+	charsets.clear();
+	built = conf;
+
+	if (!(conf.no_lowertiles && conf.no_uppertiles)) {
+		for (int y = 0; y < map.height; ++y) {
+			for (int x = 0; x < map.width; ++x) {
+				// Different logic between these.
+				int tindex = x + y * map.width;
+
+				if (!conf.no_lowertiles) {
+					uint16_t tid = map.lower_layer[tindex];
+					AddTile(TILES::LOWER, (csflag[tid] & 0x30) ? LAYER::UPPER : LAYER::LOWER, x, y, tid);
+				}
+
+				if (!conf.no_uppertiles) {
+					uint16_t tid = map.upper_layer[tindex];
+					AddTile(TILES::UPPER, (csflag[tid] & 0x10) ? LAYER::UPPER : LAYER::LOWER, x, y, tid);
+				}
+			}
+		}
+	}
+
+	if (!conf.no_events) {
+		for (const lcf::rpg::Event& ev : map.events) {
+			AddEvent(ev, assets);
+		}
+	}
+}
+
+bool Compositor::Configure(const L2IConfig& conf) {
+	bool missing = (built.no_lowertiles && !conf.no_lowertiles)
+		|| (built.no_uppertiles && !conf.no_uppertiles)
+		|| (built.no_events && !conf.no_events);
+	bool changed = built.ignore_conditions != conf.ignore_conditions
+		|| built.simulate_movement != conf.simulate_movement;
+
+	this->conf = conf;
+	return !missing && !changed;
+}
+
+void Compositor::Draw(FIBITMAP* output, unsigned int threads) const {
+	BlitSurface dest(output);
+	if (!dest.Contains(0, 0, width, height)) {
+		return;
+	}
+
+	int bands = (height + BAND_HEIGHT - 1) / BAND_HEIGHT;
+	auto draw_band = [&](size_t i) {
+		int top = static_cast<int>(i) * BAND_HEIGHT;
+		BlitSurface band = dest;
+		band.top = dest.At(0, top);
+		band.height = std::min(BAND_HEIGHT, height - top);
+		DrawBand(band, top);
+	};
+
+	if (threads == 1 || bands < 2) {
+		for (int i = 0; i < bands; i++) {
+			draw_band(i);
+		}
+	} else {
+		JobPool pool(threads);
+		pool.ParallelFor(bands, draw_band);
+	}
+}
+
+void Compositor::DrawBand(const BlitSurface& band, int top) const {
+	if (band.width < width) {
+		return;
+	}
+
+	// Copies the part of a rectangle at map position x, y that is in the band
+	auto blit = [&](const BlitSurface& source, int src_x, int src_y, int x, int y, int w, int h) {
+		// the parts left of the map and above the band are not drawn
+		y -= top;
+		if (x < 0) {
+			src_x -= x;
+			w += x;
+			x = 0;
+		}
+		if (y < 0) {
+			src_y -= y;
+			h += y;
+			y = 0;
+		}
+		w = std::min(w, width - x);
+		h = std::min(h, band.height - y);
+		if (w > 0 && h > 0) {
+			AlphaKeyBlit(source, src_x, src_y, band, x, y, w, h);
+		}
+	};
+
+	const BlitSurface& source = chipset.GetSurface();
+	auto draw_tiles = [&](LAYER layer) {
+		// tiles of both map layers never overlap inside a list, so the
+		// lower map layer can be drawn first
+		for (TILES map_layer : {TILES::LOWER, TILES::UPPER}) {
+			if (map_layer == TILES::LOWER ? conf.no_lowertiles : conf.no_uppertiles) {
+				continue;
+			}
+
+			// the lists are in row-major order, only the rows in the band are visited
+			const auto& list = tiles[static_cast<int>(map_layer)][static_cast<int>(layer)];
+			auto first = std::lower_bound(list.begin(), list.end(), top,
+				[](const TileItem& tile, int y) { return (tile.y + 1) * TILE_SIZE <= y; });
+			for (auto it = first; it != list.end() && it->y * TILE_SIZE < top + band.height; ++it) {
+				blit(source, it->rect.x, it->rect.y, it->x * TILE_SIZE, it->y * TILE_SIZE, TILE_SIZE, TILE_SIZE);
+			}
+		}
+	};
+	auto draw_sprites = [&](LAYER layer) {
+		if (conf.no_events) {
+			return;
+		}
+		for (const SpriteItem& sprite : sprites[static_cast<int>(layer)]) {
+			blit(sprite.source, sprite.src_x, sprite.src_y, sprite.x, sprite.y, sprite.width, sprite.height);
+		}
+	};
+
+	draw_tiles(LAYER::LOWER);
+	draw_sprites(LAYER::LOWER);
+	draw_sprites(LAYER::UPPER);
+	draw_tiles(LAYER::UPPER);
+	draw_sprites(LAYER::EVENTS);
+}
+
+void Compositor::AddTile(TILES source, LAYER layer, int x, int y, unsigned short tile) {
+	const Chipset::TileRect& rect = chipset.LookupTile(tile);
+	if (rect.x != Chipset::INVALID_TILE) {
+		tiles[static_cast<int>(source)][static_cast<int>(layer)].push_back({
+			static_cast<uint16_t>(x), static_cast<uint16_t>(y), rect});
+	}
+}
+
+void Compositor::AddEvent(const lcf::rpg::Event& ev, Assets& assets) {
+	const lcf::rpg::EventPage* evp = nullptr;
+
+	if (conf.ignore_conditions) {
+		evp = &ev.pages[0];
+	} else {
+		// Find highest page without conditions
+		for (int i = 0; i < (int)ev.pages.size(); ++i) {
+			const auto& flg = ev.pages[i].condition.flags;
+			if (flg.switch_a || flg.switch_b || flg.variable || flg.item || flg.actor || flg.timer || flg.timer2)
+				continue;
+			evp = &ev.pages[i];
+		}
+	}
+	if (!evp) {
+		return;
+	}
+
+	// Event layering, unknown layers are drawn on all of them
+	bool known_layer = evp->layer >= static_cast<int>(LAYER::LOWER)
+		&& evp->layer <= static_cast<int>(LAYER::EVENTS);
+	auto add = [&](const SpriteItem& sprite) {
+		if (known_layer) {
+			AddSprite(static_cast<LAYER>(evp->layer), sprite);
+		} else {
+			AddSprite(LAYER::LOWER, sprite);
+			AddSprite(LAYER::UPPER, sprite);
+			AddSprite(LAYER::EVENTS, sprite);
+		}
+	};
+
+	if (evp->character_name.empty()) {
+		const Chipset::TileRect& rect = chipset.LookupTile(TILETYPE::UPPER + evp->character_index);
+		if (rect.x == Chipset::INVALID_TILE) {
+			std::cout << "Source dimension error.\n";
+			return;
+		}
+
+		SpriteItem sprite{chipset.GetSurface(), rect.x, rect.y,
+			ev.x * TILE_SIZE, ev.y * TILE_SIZE, TILE_SIZE, TILE_SIZE};
+		if (sprite.x < 0 || sprite.y < 0 || sprite.x + TILE_SIZE > width || sprite.y + TILE_SIZE > height) {
+			return;
+		}
+		add(sprite);
+		return;
+	}
+
+	std::string cname = lcf::ToString(evp->character_name);
+	auto found = charsets.find(cname);
+	if (found == charsets.end()) {
+		found = charsets.emplace(cname, assets.GetCharSet(cname, conf.verbose)).first;
+	}
+	FIBITMAP* charset = found->second.get();
+	if (!charset) {
+		return;
+	}
+
+	int frame = evp->character_pattern;
+	if (conf.simulate_movement &&
+		(evp->animation_type == 0 || evp->animation_type == 2 || evp->animation_type == 6)) {
+		// middle frame
+		frame = 1;
+	}
+
+	SpriteItem sprite{BlitSurface(charset),
+		(evp->character_index % 4) * 72 + frame * 24,
+		(evp->character_index / 4) * 128 + evp->character_direction * 32,
+		ev.x * TILE_SIZE-4, ev.y * TILE_SIZE-16, // Why -4 and -16?
+		24, 32};
+
+	if (!sprite.source.top) {
+		std::cout << "Source or Destination have wrong format.\n";
+		return;
+	}
+	if (!sprite.source.Contains(sprite.src_x, sprite.src_y, sprite.width, sprite.height)) {
+		std::cout << "Source dimension error.\n";
+		return;
+	}
+
+	// Event special case: draw only part on borders, clipped when drawing
+	if (sprite.x + sprite.width <= 0 || sprite.y + sprite.height <= 0
+		|| sprite.x >= width || sprite.y >= height) {
+		std::cout << "Skipping zero/negative size copy.\n";
+		return;
+	}
+	add(sprite);
+}
+
+void Compositor::AddSprite(LAYER layer, const SpriteItem& sprite) {
+	sprites[static_cast<int>(layer)].push_back(sprite);
+}
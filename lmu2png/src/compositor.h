@@ -0,0 +1,130 @@
+/* compositor.h, draw lists for the layers of a map.
+   Copyright (C) 2026 EasyRPG Project <https://github.com/EasyRPG/>.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#ifndef COMPOSITOR_H
+#define COMPOSITOR_H
+
+// Headers
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <lcf/rpg/map.h>
+#include "blit.h"
+#include "chipset.h"
+#include "main.h"
+
+// forward declarations
+
+class Assets;
+
+/**
+ * Sorts the tiles and events of a map into one draw list per layer in a
+ * single scan and draws the lists back to front:
+ * lower tiles, below-player events, player-level events, upper tiles and
+ * above-player events.
+ *
+ * Tiles are kept in row-major order, events in map order because their
+ * overlap decides which one is visible. The image is drawn in independent
+ * horizontal bands, entries overhanging a band are clipped against it.
+ *
+ * The lists of the lower and upper map layer are kept apart, so hiding
+ * tiles or events that were built only needs another Draw.
+ */
+class Compositor {
+public:
+	Compositor(const Chipset& chipset, const L2IConfig& conf);
+
+	/**
+	 * Fills the draw lists, replacing the previous ones.
+	 *
+	 * @param map map to draw
+	 * @param csflag passability flags of the chipset, decides the tile layer
+	 * @param assets provides the CharSets of the events
+	 */
+	void Build(const lcf::rpg::Map& map, const uint8_t* csflag, Assets& assets);
+
+	/**
+	 * Changes the options used by the next Draw.
+	 *
+	 * @param conf new options
+	 * @return false when the lists do not match conf and must be built again
+	 */
+	bool Configure(const L2IConfig& conf);
+
+	// Rows drawn by one job, a multiple of the tile size
+	static constexpr int BAND_HEIGHT = 16 * TILE_SIZE;
+
+	/**
+	 * Draws all lists, one band per job.
+	 *
+	 * @param output image at least as large as the map
+	 * @param threads worker threads, 0: one per CPU core
+	 */
+	void Draw(FIBITMAP* output, unsigned int threads = 1) const;
+
+	/**
+	 * Draws the part of the map in one band of rows.
+	 *
+	 * @param band surface for the rows, at least as wide as the map
+	 * @param top map row drawn into the first row of band
+	 */
+	void DrawBand(const BlitSurface& band, int top) const;
+
+private:
+	// Map layer of a tile
+	enum class TILES : int {
+		LOWER = 0,
+		UPPER
+	};
+
+	// A tile at a map cell
+	struct TileItem {
+		uint16_t x;
+		uint16_t y;
+		Chipset::TileRect rect;
+	};
+
+	// An event graphic at its map position, can overhang the borders
+	struct SpriteItem {
+		BlitSurface source;
+		int src_x;
+		int src_y;
+		int x;
+		int y;
+		int width;
+		int height;
+	};
+
+	void AddTile(TILES source, LAYER layer, int x, int y, unsigned short tile);
+	void AddEvent(const lcf::rpg::Event& ev, Assets& assets);
+	void AddSprite(LAYER layer, const SpriteItem& sprite);
+
+	const Chipset& chipset;
+	L2IConfig conf;
+	// options the lists were built with
+	L2IConfig built;
+	// CharSets of the events, kept alive while drawing
+	std::map<std::string, std::shared_ptr<FIBITMAP>> charsets;
+	int width = 0;
+	int height = 0;
+	// by map layer and draw layer
+	std::vector<TileItem> tiles[2][2];
+	std::vector<SpriteItem> sprites[3];
+};
+
+#endif
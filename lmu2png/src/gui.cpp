@@ -18,8 +18,8 @@
 #include <wx/filedlg.h>
 #include <wx/aboutdlg.h>
 #include <wx/dcbuffer.h>
-#include <wx/rawbmp.h>
 #include "main.h"
+#include "pngprofile.h"
 
 wxIMPLEMENT_APP_NO_MAIN(Lmu2Png);
 
@@ -148,6 +148,9 @@ MyFrame::MyFrame():
 	m_cbSM = create_checkbox("Simulate &Movement", false);
 	m_cbSM->SetToolTip("For event pages with certain animation types, draw the middle frame "
 		"instead of the frame specified for the page");
+	m_cbRB = create_checkbox("&Repeat Background", false);
+	m_cbRB->SetToolTip("Repeat the parallax background at its own size like the game does, "
+		"instead of stretching it to the map size");
 
 	sl->Add(box, wxSizerFlags().Expand().DoubleBorder());
 
@@ -298,11 +301,21 @@ void MyFrame::OnQuit(wxCommandEvent& WXUNUSED(event)) {
 void MyFrame::OnSave(wxCommandEvent& WXUNUSED(event)) {
 	wxBusyCursor wait;
 
+	// one file type per output profile
+	wxString wildcard;
+	for (const auto& profile : GetPngProfiles()) {
+		if (!wildcard.empty())
+			wildcard += "|";
+		wildcard += wxString::Format("PNG files, %s - %s (*.png)|*.png",
+			profile.name, profile.description);
+	}
+
 	wxFileDialog dlg(this, "Save PNG file", wxEmptyString, "map.png",
-		"PNG files (*.png)|*.png", wxFD_SAVE|wxFD_OVERWRITE_PROMPT);
+		wildcard, wxFD_SAVE|wxFD_OVERWRITE_PROMPT);
 	if (dlg.ShowModal() == wxID_CANCEL) return;
 
-	if (m_canvas->Save(dlg.GetPath()))
+	const PngProfile& profile = GetPngProfiles()[dlg.GetFilterIndex()];
+	if (m_canvas->Save(dlg.GetPath(), profile))
 		SetStatusText("Image saved.");
 	else
 		SetStatusText("Could not save image!");
@@ -342,17 +355,17 @@ void MyFrame::Update() {
 	conf.no_events = !m_cbEV->IsChecked();
 	conf.ignore_conditions = m_cbIC->IsChecked();
 	conf.simulate_movement = m_cbSM->IsChecked();
+	conf.repeat_panorama = m_cbRB->IsChecked();
 #ifndef NDEBUG
 	conf.verbose = true;
 #endif
 
-	// generate image
-	int w, h;
-	unsigned char *pixels = makeImage(conf, w, h, guiErrorCallback, (void *)this);
-	if(!pixels) return;
-
-	m_canvas->Load(pixels, w, h);
-	delete[] pixels;
+	// generate image straight into the canvas bitmap
+	bool success = makeImage(conf, [this](int w, int h, ImageBuffer& buffer) {
+		return m_canvas->BeginLoad(w, h, buffer);
+	}, guiErrorCallback, (void *)this);
+	m_canvas->EndLoad(success);
+	if(!success) return;
 
 	SetStatusText("Image generated!");
 }
@@ -375,39 +388,49 @@ void MyCanvas::Clear() {
 	Refresh();
 }
 
-void MyCanvas::Load(unsigned char *pixels, int w, int h) {
+bool MyCanvas::BeginLoad(int w, int h, ImageBuffer& buffer) {
 	m_bmp = std::make_unique<wxBitmap>(w, h, 32);
-	if(!m_bmp->Ok()) return;
-
-	wxAlphaPixelData bmdata(*m_bmp);
-	if(!bmdata) return;
-
-	// convert image
-	unsigned char *src = pixels;
-	wxAlphaPixelData::Iterator dst(bmdata);
-	for(int y = 0; y<h; y++) {
-		dst.MoveTo(bmdata, 0, y);
-		for(int x = 0; x < w; x++) {
-			// wxBitmap contains rgb values pre-multiplied with alpha
-			unsigned char a = src[3];
-			dst.Red() = src[0] * a / 255;
-			dst.Green() = src[1] * a / 255;
-			dst.Blue() = src[2] * a / 255;
-			dst.Alpha() = a;
-			dst++;
-			src += 4;
-		}
+	if(!m_bmp->IsOk()) return false;
+
+	m_data = std::make_unique<wxAlphaPixelData>(*m_bmp);
+	if(!*m_data) return false;
+
+	// let the renderer write in the native pixel order
+	wxAlphaPixelData::Iterator it(*m_data);
+	buffer.pixels = reinterpret_cast<unsigned char *>(it.m_ptr);
+	buffer.stride = m_data->GetRowStride();
+	buffer.red = wxAlphaPixelFormat::RED;
+	buffer.green = wxAlphaPixelFormat::GREEN;
+	buffer.blue = wxAlphaPixelFormat::BLUE;
+	buffer.alpha = wxAlphaPixelFormat::ALPHA;
+	// wxBitmap contains rgb values pre-multiplied with alpha
+	buffer.premultiplied = true;
+
+	return true;
+}
+
+void MyCanvas::EndLoad(bool success) {
+	// releasing the raw data commits it on some platforms
+	m_data.reset();
+	if(!success) {
+		m_bmp = std::make_unique<wxBitmap>();
 	}
 
 	// show it
 	Refresh();
 }
 
-bool MyCanvas::Save(wxString path) {
+bool MyCanvas::Save(wxString path, const PngProfile& profile) {
 	if(!m_bmp->IsOk()) return false;
 
-	m_bmp->SaveFile(path, wxBITMAP_TYPE_PNG);
-	return true;
+	wxImage img = m_bmp->ConvertToImage();
+	img.SetOption(wxIMAGE_OPTION_PNG_COMPRESSION_LEVEL, profile.level);
+	img.SetOption(wxIMAGE_OPTION_PNG_COMPRESSION_MEM_LEVEL, profile.mem_level);
+	img.SetOption(wxIMAGE_OPTION_PNG_COMPRESSION_STRATEGY, profile.strategy);
+	if (profile.filters != PngProfile::filter_default)
+		img.SetOption(wxIMAGE_OPTION_PNG_FILTER, profile.filters);
+
+	return img.SaveFile(path, wxBITMAP_TYPE_PNG);
 }
 
 void MyCanvas::OnPaint(wxPaintEvent& WXUNUSED(event)) {
@@ -21,6 +21,7 @@
 #ifndef WX_PRECOMP
 	#include "wx/wx.h"
 #endif
+#include <wx/rawbmp.h>
 
 class Lmu2Png : public wxApp {
 public:
@@ -28,17 +29,23 @@ public:
 	virtual bool OnInit() override;
 };
 
+struct PngProfile;
+struct ImageBuffer;
+
 class MyCanvas : public wxScrolledWindow {
 public:
 	MyCanvas(wxWindow *parent);
 
 	void Clear();
-	void Load(unsigned char *pixels, int w, int h);
-	bool Save(wxString path);
+	bool BeginLoad(int w, int h, ImageBuffer& buffer);
+	void EndLoad(bool success);
+	bool Save(wxString path, const PngProfile& profile);
 	void OnPaint(wxPaintEvent &event);
 
 private:
 	std::unique_ptr<wxBitmap> m_bmp;
+	// raw access to m_bmp while it is being filled
+	std::unique_ptr<wxAlphaPixelData> m_data;
 
 	wxDECLARE_EVENT_TABLE();
 };
@@ -66,7 +73,7 @@ private:
 	MyCanvas *m_canvas;
 
 	// widgets we need to query
-	wxCheckBox   *m_cbBG, *m_cbLT, *m_cbUT, *m_cbEV, *m_cbIC, *m_cbSM;
+	wxCheckBox   *m_cbBG, *m_cbLT, *m_cbUT, *m_cbEV, *m_cbIC, *m_cbSM, *m_cbRB;
 	wxStaticText *m_stMap, *m_stDB, *m_stCS;
 	wxChoice     *m_choiceEnc;
 
@@ -15,6 +15,7 @@
    along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
 
 // Headers
+#include <cctype>
 #include <cstdio>
 #include <cstdlib>
 #include <iostream>
@@ -22,6 +23,8 @@
 #include <string>
 #include <map>
 #include <algorithm>
+#include <vector>
+#include <filesystem>
 #include <argparse.hpp>
 #include <lcf/reader_lcf.h>
 #include <lcf/ldb/reader.h>
@@ -34,18 +37,40 @@
 
 #include <FreeImage.h>
 
+#include "assets.h"
+#include "batch.h"
+#include "blit.h"
 #include "chipset.h"
+#include "compositor.h"
 #include "xyzplugin.h"
 #include "main.h"
+#include "pngprofile.h"
+#include "pngwriter.h"
 #include "utils.h"
 
 void MyFreeImageMessageHandler(FREE_IMAGE_FORMAT /* fif */, const char *message) {
 	std::cout << "FreeImage error: " << message << "\n";
 }
 
+// State shared by all maps rendered with --all, images are shared by Assets
+struct Project {
+	std::unique_ptr<lcf::rpg::Database> database;
+};
+
 // internal functions
-static BitmapPtr process(L2IConfig conf, ErrorCallbackFunc error_cb, ErrorCallbackParam param = nullptr);
+static std::unique_ptr<lcf::rpg::Map> loadMap(L2IConfig& conf, uint8_t* csflag,
+	ErrorCallbackFunc error_cb, ErrorCallbackParam param, Project* project);
+static BitmapPtr process(L2IConfig conf, ErrorCallbackFunc error_cb, ErrorCallbackParam param = nullptr,
+	Project* project = nullptr);
+static bool processStream(L2IConfig conf, const std::string& output, const PngProfile& profile,
+	ErrorCallbackFunc error_cb, ErrorCallbackParam param = nullptr, Project* project = nullptr);
+static int processAll(L2IConfig conf, const std::string& directory, const std::string& output,
+	const PngProfile& profile, int jobs, bool stream);
+static std::vector<std::string> findMaps(const std::string& directory);
+static void printAssetStatistics(const L2IConfig& conf);
 static void cliErrorCallback(const std::string& error, ErrorCallbackParam param = nullptr);
+static void streamErrorCallback(const std::string& error, ErrorCallbackParam param);
+static int GetFreeImagePngFlags(const PngProfile& profile);
 
 int main(int argc, char** argv) {
 	auto handleFreeImage = []() {
@@ -59,6 +84,10 @@ int main(int argc, char** argv) {
 	};
 
 	std::string output;
+	std::string profile_name = GetPngProfiles()[0].name;
+	bool all = false;
+	bool stream = false;
+	int jobs = 1;
 	L2IConfig conf = {};
 
 	// add usage and help messages
@@ -73,7 +102,7 @@ int main(int argc, char** argv) {
 
 	// Parse arguments
 	cli.add_argument("mapfile").required().store_into(conf.map)
-		.help("Map file to render")
+		.help("Map file to render, or a game directory to render all maps")
 		.metavar("MapXXXX.lmu");
 	cli.add_argument("-e", "--encoding").store_into(conf.encoding)
 		.help("Project encoding (defaults to autodetection)")
@@ -85,14 +114,36 @@ int main(int argc, char** argv) {
 		.help("Chipset file to use; if unspecified, will be read from\n"
 			"the database").metavar("IMG");
 	cli.add_argument("-o", "--output").store_into(output)
-		.help("Set the output filepath (defaults to map name)")
+		.help("Set the output filepath (defaults to map name), the output\n"
+			"directory when rendering all maps (defaults to the game directory)")
 		.metavar("PNG");
+	cli.add_argument("-a", "--all").store_into(all)
+		.help("Render all Map*.lmu files in the directory of the map file\n"
+			"(subdirectories are skipped), the database and the images are\n"
+			"loaded only once").flag();
+	cli.add_argument("-j", "--jobs").store_into(jobs).metavar("N")
+		.help("Render N maps in parallel, or a single map in N bands\n"
+			"(0: one per CPU core, default: 1)");
+	auto& profile_arg = cli.add_argument("-P", "--profile").store_into(profile_name)
+		.metavar("NAME").help(GetPngProfileHelp());
+	for (const auto& profile : GetPngProfiles()) {
+		profile_arg.add_choice(profile.name);
+	}
+	cli.add_argument("-s", "--stream").store_into(stream)
+		.help("Render and write the image in bands of rows instead of as a\n"
+			"whole, uses less memory for large maps").flag();
+	cli.add_argument("--cache").store_into(conf.cache)
+		.help("Keep the tile atlas of every chipset in DIR, later runs\n"
+			"using an unchanged chipset skip building it").metavar("DIR");
 	cli.add_argument("--verbose").store_into(conf.verbose)
 		.help("Explain what is being done").flag();
 
 	cli.add_group("Graphic Options");
 	cli.add_argument("-B", "--no-background").store_into(conf.no_background)
 		.help("Do not draw the parallax background").flag();
+	cli.add_argument("-R", "--repeat-background").store_into(conf.repeat_panorama)
+		.help("Repeat the parallax background at its own size like the game\n"
+			"does, instead of stretching it to the map size").flag();
 	cli.add_argument("-L", "--no-lowertiles").store_into(conf.no_lowertiles)
 		.help("Do not draw lower layer tiles").flag();
 	cli.add_argument("-U", "--no-uppertiles").store_into(conf.no_uppertiles)
@@ -126,20 +177,45 @@ int main(int argc, char** argv) {
 		std::exit(EXIT_FAILURE);
 	}
 
+	if (jobs < 0) {
+		std::cerr << "Invalid amount of jobs: " << jobs << "\n";
+		std::exit(EXIT_FAILURE);
+	}
+
 	handleFreeImage();
 
+	const PngProfile& profile = *FindPngProfile(profile_name);
+
+	std::error_code ec;
+	if (std::filesystem::is_directory(conf.map, ec)) {
+		return processAll(conf, conf.map, output, profile, jobs, stream);
+	}
+	if (all) {
+		std::string directory = GetFileDirectory(conf.map);
+		return processAll(conf, directory, output, profile, jobs, stream);
+	}
+
+	if (output.empty()){
+		output = conf.map.substr(0, conf.map.length() - 3) + "png";
+	}
+
+	conf.threads = static_cast<unsigned int>(jobs);
+	if (stream) {
+		bool success = processStream(conf, output, profile, cliErrorCallback);
+		printAssetStatistics(conf);
+		return success ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
 	// generate image
 	auto img = process(conf, cliErrorCallback);
+	printAssetStatistics(conf);
 	if (!img) {
 		std::exit(EXIT_FAILURE);
 	}
 
 	// save image
-	if (output.empty()){
-		output = conf.map.substr(0, conf.map.length() - 3) + "png";
-	}
 
-	if (!FreeImage_Save(FIF_PNG, img.get(), output.c_str(), PNG_Z_BEST_COMPRESSION)) {
+	if (!FreeImage_Save(FIF_PNG, img.get(), output.c_str(), GetFreeImagePngFlags(profile))) {
 		cliErrorCallback("Error saving \"" + output + "\".");
 		std::exit(EXIT_FAILURE);
 	}
@@ -147,14 +223,17 @@ int main(int argc, char** argv) {
 	return EXIT_SUCCESS;
 }
 
-static BitmapPtr process(L2IConfig conf, ErrorCallbackFunc error_cb, ErrorCallbackParam param) {
+static std::unique_ptr<lcf::rpg::Map> loadMap(L2IConfig& conf, uint8_t* csflag,
+	ErrorCallbackFunc error_cb, ErrorCallbackParam param, Project* project) {
 	if (!Exists(conf.map)) {
 		error_cb("Input map file " + conf.map +" cannot be found.", param);
 		return nullptr;
 	}
 
 	std::string path = GetFileDirectory(conf.map);
-	CollectResourcePaths(path);
+	if (!project) {
+		CollectResourcePaths(path);
+	}
 
 	if (conf.encoding.empty()) {
 		conf.encoding = lcf::ReaderUtil::GetEncoding(path + "RPG_RT.ini");
@@ -167,17 +246,21 @@ static BitmapPtr process(L2IConfig conf, ErrorCallbackFunc error_cb, ErrorCallba
 	}
 
 	// ChipSet flags
-	uint8_t csflag[65536] = {0};
 	if (conf.chipset.empty()) {
 		// Get chipset from database
-		if (conf.database.empty()) {
-			conf.database = path + "RPG_RT.ldb";
-		}
-
-		auto db = lcf::LDB_Reader::Load(conf.database, conf.encoding);
+		std::unique_ptr<lcf::rpg::Database> local_db;
+		const lcf::rpg::Database* db = project ? project->database.get() : nullptr;
 		if (!db) {
-			error_cb(lcf::LcfReader::GetError(), param);
-			return nullptr;
+			if (conf.database.empty()) {
+				conf.database = path + "RPG_RT.ldb";
+			}
+
+			local_db = lcf::LDB_Reader::Load(conf.database, conf.encoding);
+			if (!local_db) {
+				error_cb(lcf::LcfReader::GetError(), param);
+				return nullptr;
+			}
+			db = local_db.get();
 		}
 
 		assert(map->chipset_id <= static_cast<int>(db->chipsets.size()));
@@ -218,23 +301,166 @@ static BitmapPtr process(L2IConfig conf, ErrorCallbackFunc error_cb, ErrorCallba
 		memset(csflag + 10000, 0x10, 144);
 	}
 
+	// Just do the Y-sort here. Yes, it modifies the data that's supposed to be rendered.
+	// Doesn't particularly matter. What does matter is that this has to be a stable_sort,
+	// so equivalent Y still causes ID order to be prioritized (just in case)
+	// Also done without events, the GUI can show them later without loading the map again.
+	std::stable_sort(map->events.begin(), map->events.end(),
+		[](const auto& ev1, const auto& ev2) { return ev1.y < ev2.y; });
+
+	return map;
+}
+
+static BitmapPtr process(L2IConfig conf, ErrorCallbackFunc error_cb, ErrorCallbackParam param,
+	Project* project) {
+	uint8_t csflag[65536] = {0};
+	std::unique_ptr<lcf::rpg::Map> map = loadMap(conf, csflag, error_cb, param, project);
+	if (!map) {
+		return nullptr;
+	}
+
 	BitmapPtr output_img{FreeImage_Allocate(map->width * TILE_SIZE, map->height * TILE_SIZE, 32)};
 	if (!output_img) {
 		error_cb("Unable to create output image.", param);
 		return nullptr;
 	}
 
-	if (!conf.no_events) {
-		// Just do the Y-sort here. Yes, it modifies the data that's supposed to be rendered.
-		// Doesn't particularly matter. What does matter is that this has to be a stable_sort,
-		// so equivalent Y still causes ID order to be prioritized (just in case)
-		std::stable_sort(map->events.begin(), map->events.end(),
-			[](const auto& ev1, const auto& ev2) { return ev1.y < ev2.y; });
+	RenderCore(output_img.get(), csflag, map, conf, Assets::Instance());
+
+	return output_img;
+}
+
+static bool processStream(L2IConfig conf, const std::string& output, const PngProfile& profile,
+	ErrorCallbackFunc error_cb, ErrorCallbackParam param, Project* project) {
+	uint8_t csflag[65536] = {0};
+	std::unique_ptr<lcf::rpg::Map> map = loadMap(conf, csflag, error_cb, param, project);
+	if (!map) {
+		return false;
+	}
+
+	std::string error;
+	PngWriter writer;
+	if (!writer.Open(output, map->width * TILE_SIZE, map->height * TILE_SIZE, profile, error)) {
+		error_cb(error, param);
+		return false;
 	}
 
-	RenderCore(output_img.get(), csflag, map, conf);
+	auto write_band = [&writer, &error](const BlitSurface& band) {
+		return writer.WriteBand(band, error);
+	};
 
-	return output_img;
+	if (!RenderBands(csflag, map, conf, Assets::Instance(), write_band) || !writer.Finish(error)) {
+		error_cb(error.empty() ? "Error rendering \"" + output + "\"." : error, param);
+		return false;
+	}
+	return true;
+}
+
+static int processAll(L2IConfig conf, const std::string& directory, const std::string& output,
+	const PngProfile& profile, int jobs, bool stream) {
+	std::string path = directory;
+	if (path.back() != '/' && path.back() != '\\') {
+		path += "/";
+	}
+
+	// Everything shared by the maps is set up only once
+	CollectResourcePaths(path);
+
+	if (conf.encoding.empty()) {
+		conf.encoding = lcf::ReaderUtil::GetEncoding(path + "RPG_RT.ini");
+	}
+
+	Project project;
+	if (conf.chipset.empty()) {
+		if (conf.database.empty()) {
+			conf.database = path + "RPG_RT.ldb";
+		}
+
+		project.database = lcf::LDB_Reader::Load(conf.database, conf.encoding);
+		if (!project.database) {
+			cliErrorCallback(lcf::LcfReader::GetError());
+			return EXIT_FAILURE;
+		}
+	}
+
+	Batch::Options options;
+	options.input_extension = ".lmu";
+	options.output_extension = ".png";
+	options.output_directory = output.empty() ? directory : output;
+	options.threads = static_cast<unsigned int>(jobs);
+
+	std::vector<Batch::Job> batch = Batch::Collect(findMaps(directory), options, std::cerr);
+	if (batch.empty()) {
+		cliErrorCallback("No map files found in " + directory + ".");
+		return EXIT_FAILURE;
+	}
+
+	size_t failed = Batch::Run(batch, options,
+		[&conf, &profile, &project, stream](const Batch::Job& job, std::ostream& err) {
+			L2IConfig map_conf = conf;
+			map_conf.map = job.input;
+			// the maps are rendered in parallel instead
+			map_conf.threads = 1;
+
+			if (stream) {
+				return processStream(map_conf, job.output, profile, streamErrorCallback, &err, &project);
+			}
+
+			auto img = process(map_conf, streamErrorCallback, &err, &project);
+			if (!img) {
+				return false;
+			}
+
+			if (!FreeImage_Save(FIF_PNG, img.get(), job.output.c_str(), GetFreeImagePngFlags(profile))) {
+				err << "Error saving \"" << job.output << "\".\n";
+				return false;
+			}
+			return true;
+		});
+	printAssetStatistics(conf);
+
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static std::vector<std::string> findMaps(const std::string& directory) {
+	// Only the maps of the project, not backups or copies in subdirectories
+	std::vector<std::string> maps;
+	std::error_code ec;
+	std::filesystem::directory_iterator it(directory, ec);
+	for (; !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+		const auto& entry = *it;
+		std::string name = entry.path().filename().string();
+		std::transform(name.begin(), name.end(), name.begin(),
+			[](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+		if (name.size() > 7 && name.compare(0, 3, "map") == 0
+			&& name.compare(name.size() - 4, 4, ".lmu") == 0 && entry.is_regular_file(ec)) {
+			maps.push_back(entry.path().string());
+		}
+	}
+	if (ec) {
+		cliErrorCallback("Error reading directory " + directory + ": " + ec.message() + ".");
+	}
+
+	std::sort(maps.begin(), maps.end());
+	return maps;
+}
+
+static int GetFreeImagePngFlags(const PngProfile& profile) {
+	// FreeImage only exposes the zlib level
+	if (profile.level == Z_NO_COMPRESSION) {
+		return PNG_Z_NO_COMPRESSION;
+	}
+	return profile.level;
+}
+
+static void printAssetStatistics(const L2IConfig& conf) {
+	if (!conf.verbose) {
+		return;
+	}
+
+	Assets::Statistics stats = Assets::Instance().GetStatistics();
+	std::cerr << "Image cache: " << stats.hits << " hits, " << stats.misses << " misses, "
+		<< stats.evictions << " evicted, " << (stats.bytes + 512 * 1024) / (1024 * 1024) << " MiB\n";
 }
 
 static void cliErrorCallback(const std::string& error, ErrorCallbackParam) {
@@ -242,45 +468,106 @@ static void cliErrorCallback(const std::string& error, ErrorCallbackParam) {
 	std::cerr << error << "\n";
 }
 
+static void streamErrorCallback(const std::string& error, ErrorCallbackParam param) {
+	// Collected per map, printed by the batch
+	*static_cast<std::ostream*>(param) << error << "\n";
+}
+
 #ifdef WITH_GUI
-unsigned char *makeImage(L2IConfig conf, int &w, int &h, ErrorCallbackFunc error_cb,
-	ErrorCallbackParam param) {
+// Kept between the renders of the GUI, so changing an option neither loads
+// the map again nor builds the draw lists when they already match
+struct GuiSession {
+	// options as passed by the GUI and as completed by loadMap
+	L2IConfig input;
+	L2IConfig conf;
+	std::filesystem::file_time_type map_time;
+	std::filesystem::file_time_type database_time;
+	std::unique_ptr<lcf::rpg::Map> map;
+	uint8_t csflag[65536];
+	std::shared_ptr<Chipset> chipset;
+	std::unique_ptr<Compositor> compositor;
+};
+
+static BitmapPtr processGui(L2IConfig conf, ErrorCallbackFunc error_cb, ErrorCallbackParam param) {
+	static GuiSession session;
+	Assets& assets = Assets::Instance();
+
+	auto file_time = [](const std::string& file) {
+		std::error_code ec;
+		return std::filesystem::last_write_time(file, ec);
+	};
 
-	// generate image
-	auto img = process(conf, error_cb, param);
-	if (!img) {
-		return nullptr;
+	bool reload = !session.map
+		|| conf.map != session.input.map
+		|| conf.database != session.input.database
+		|| conf.chipset != session.input.chipset
+		|| conf.encoding != session.input.encoding
+		|| file_time(conf.map) != session.map_time
+		|| file_time(session.conf.database) != session.database_time;
+
+	if (reload) {
+		session.compositor.reset();
+		session.chipset.reset();
+		session.input = conf;
+		std::fill(std::begin(session.csflag), std::end(session.csflag), 0);
+		session.map = loadMap(conf, session.csflag, error_cb, param, nullptr);
+		if (!session.map) {
+			return nullptr;
+		}
+		session.conf = conf;
+		session.map_time = file_time(conf.map);
+		session.database_time = file_time(conf.database);
+	} else {
+		// only scan again when images were added or removed since the last render
+		if (ResourcesChanged()) {
+			std::string path = GetFileDirectory(conf.map);
+			CollectResourcePaths(path);
+		}
+
+		conf.encoding = session.conf.encoding;
+		conf.database = session.conf.database;
+		conf.chipset = session.conf.chipset;
 	}
 
-	w = FreeImage_GetWidth(img.get());
-	h = FreeImage_GetHeight(img.get());
-	int bytespp = FreeImage_GetBPP(img.get()) / 8;
-	assert(bytespp == 4);
+	std::shared_ptr<Chipset> chipset = assets.GetChipset(conf);
+	if (!session.compositor || chipset != session.chipset || !session.compositor->Configure(conf)) {
+		session.chipset = chipset;
+		session.compositor = std::make_unique<Compositor>(*chipset, conf);
+		session.compositor->Build(*session.map, session.csflag, assets);
+	}
 
-	// create buffer
-	unsigned char *img_data = new unsigned char[w * h * bytespp];
-	if(!img_data) {
+	const lcf::rpg::Map& map = *session.map;
+	BitmapPtr output_img{FreeImage_Allocate(map.width * TILE_SIZE, map.height * TILE_SIZE, 32)};
+	if (!output_img) {
+		error_cb("Unable to create output image.", param);
 		return nullptr;
 	}
 
-	// copy for use in a wxBitmap
-	unsigned char *dst = img_data;
-	for(int y = 0; y < h; y++) {
-		// set position to upper left corner
-		BYTE *src_bits = FreeImage_GetScanLine(img.get(), h - 1 - y);
+	DrawBackground(output_img.get(), map, conf, assets);
+	session.compositor->Draw(output_img.get(), conf.threads);
 
-		for(int x = 0; x < w; x++) {
-			dst[0] = src_bits[FI_RGBA_RED];
-			dst[1] = src_bits[FI_RGBA_GREEN];
-			dst[2] = src_bits[FI_RGBA_BLUE];
-			dst[3] = src_bits[FI_RGBA_ALPHA];
+	return output_img;
+}
 
-			// next pixel
-			src_bits += bytespp;
-			dst += bytespp;
-		}
+bool makeImage(L2IConfig conf, const ImageBufferFunc& get_buffer, ErrorCallbackFunc error_cb,
+	ErrorCallbackParam param) {
+
+	// generate image
+	auto img = processGui(conf, error_cb, param);
+	if (!img) {
+		return false;
 	}
 
-	return img_data;
+	BlitSurface surface(img.get());
+	ImageBuffer buffer;
+	if (!surface.top || !get_buffer(surface.width, surface.height, buffer) || !buffer.pixels) {
+		return false;
+	}
+
+	// one pass from the bottom-up scanlines into the GUI bitmap
+	const PixelOrder order = { buffer.red, buffer.green, buffer.blue, buffer.alpha };
+	CopyToBuffer(surface, buffer.pixels, buffer.stride, order, buffer.premultiplied);
+
+	return true;
 }
 #endif
@@ -18,6 +18,8 @@
 #define MAIN_H
 
 // Headers
+#include <cstddef>
+#include <functional>
 #include <string>
 
 // Types
@@ -29,6 +31,7 @@ using L2IConfig = struct l2i_config_t {
 	std::string chipset;
 	std::string encoding;
 	std::string map;
+	std::string cache;
 	bool verbose;
 	bool no_background;
 	bool no_lowertiles;
@@ -36,10 +39,31 @@ using L2IConfig = struct l2i_config_t {
 	bool no_events;
 	bool ignore_conditions;
 	bool simulate_movement;
+	bool repeat_panorama;
+	// threads rendering one map, 0: one per CPU core
+	unsigned int threads;
 };
 
 #ifdef WITH_GUI
-unsigned char * makeImage(L2IConfig conf, int &w, int &h, ErrorCallbackFunc error_cb,
+// Top-down 32 bit pixel buffer provided by the GUI
+struct ImageBuffer {
+	// top left pixel
+	unsigned char *pixels = nullptr;
+	// bytes from a row to the one below it, may be negative
+	std::ptrdiff_t stride = 0;
+	// byte positions of the channels in a pixel
+	int red = 0;
+	int green = 1;
+	int blue = 2;
+	int alpha = 3;
+	// colors are multiplied with alpha
+	bool premultiplied = false;
+};
+
+// Receives the image size and fills in a buffer for it, false on failure
+using ImageBufferFunc = std::function<bool(int w, int h, ImageBuffer& buffer)>;
+
+bool makeImage(L2IConfig conf, const ImageBufferFunc& get_buffer, ErrorCallbackFunc error_cb,
 	ErrorCallbackParam param = nullptr);
 #endif
 
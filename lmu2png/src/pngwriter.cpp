@@ -0,0 +1,125 @@
+/* pngwriter.cpp, row by row PNG output.
+   Copyright (C) 2026 EasyRPG Project <https://github.com/EasyRPG/>.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+// Headers
+#include <csetjmp>
+#include "pngwriter.h"
+
+PngWriter::~PngWriter() {
+	// not finished, the file is incomplete
+	Close(true);
+}
+
+bool PngWriter::Open(const std::string& filename, int width, int height,
+	const PngProfile& profile, std::string& error) {
+	Close(true);
+	this->filename = filename;
+
+	file = fopen(filename.c_str(), "wb");
+	if (!file) {
+		error = "Error creating file " + filename + ".";
+		return false;
+	}
+
+	png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+	if (png_ptr) {
+		info_ptr = png_create_info_struct(png_ptr);
+	}
+	if (!info_ptr) {
+		error = "Error creating PNG write structure for " + filename + ".";
+		Close(true);
+		return false;
+	}
+
+	if (setjmp(png_jmpbuf(png_ptr))) {
+		error = "Error writing PNG header for " + filename + ".";
+		Close(true);
+		return false;
+	}
+	png_init_io(png_ptr, file);
+
+	// Set compression parameters
+	png_set_compression_level(png_ptr, profile.level);
+	png_set_compression_mem_level(png_ptr, profile.mem_level);
+	png_set_compression_strategy(png_ptr, profile.strategy);
+	if (profile.filters != PngProfile::filter_default) {
+		png_set_filter(png_ptr, PNG_FILTER_TYPE_BASE, profile.filters);
+	}
+	png_set_compression_buffer_size(png_ptr, 1024 * 1024);
+
+	png_set_IHDR(png_ptr, info_ptr, width, height, 8,
+		PNG_COLOR_TYPE_RGB_ALPHA, PNG_INTERLACE_NONE,
+		PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
+	png_write_info(png_ptr, info_ptr);
+
+#if FI_RGBA_RED == 2
+	// FreeImage keeps the pixels as BGRA on little endian machines
+	png_set_bgr(png_ptr);
+#endif
+
+	return true;
+}
+
+bool PngWriter::WriteBand(const BlitSurface& band, std::string& error) {
+	if (!png_ptr) {
+		error = "PNG file is not open.";
+		return false;
+	}
+
+	if (setjmp(png_jmpbuf(png_ptr))) {
+		error = "Error writing PNG rows for " + filename + ".";
+		Close(true);
+		return false;
+	}
+	for (int y = 0; y < band.height; y++) {
+		png_write_row(png_ptr, band.At(0, y));
+	}
+
+	return true;
+}
+
+bool PngWriter::Finish(std::string& error) {
+	if (!png_ptr) {
+		error = "PNG file is not open.";
+		return false;
+	}
+
+	if (setjmp(png_jmpbuf(png_ptr))) {
+		error = "Error writing PNG end for " + filename + ".";
+		Close(true);
+		return false;
+	}
+	png_write_end(png_ptr, info_ptr);
+
+	Close(false);
+	return true;
+}
+
+void PngWriter::Close(bool remove_file) {
+	if (png_ptr) {
+		png_destroy_write_struct(&png_ptr, info_ptr ? &info_ptr : nullptr);
+		png_ptr = nullptr;
+		info_ptr = nullptr;
+	}
+
+	if (file) {
+		fclose(file);
+		file = nullptr;
+		if (remove_file) {
+			remove(filename.c_str());
+		}
+	}
+}
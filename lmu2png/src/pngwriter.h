@@ -0,0 +1,70 @@
+/* pngwriter.h, row by row PNG output.
+   Copyright (C) 2026 EasyRPG Project <https://github.com/EasyRPG/>.
+
+   This program is free software: you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation, either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.  */
+
+#ifndef PNGWRITER_H
+#define PNGWRITER_H
+
+// Headers
+#include <cstdio>
+#include <string>
+#include <png.h>
+#include "blit.h"
+#include "pngprofile.h"
+
+/**
+ * Writes a 32 bit PNG file from bands of rows, so the whole image never has
+ * to be in memory. The bands must be passed from top to bottom and must
+ * add up to the height given to Open.
+ *
+ * On errors the incomplete file is removed.
+ */
+class PngWriter {
+public:
+	PngWriter() = default;
+	~PngWriter();
+
+	PngWriter(const PngWriter&) = delete;
+	PngWriter& operator=(const PngWriter&) = delete;
+
+	/**
+	 * Creates the file and writes the PNG header.
+	 *
+	 * @param filename output file
+	 * @param width image width
+	 * @param height image height
+	 * @param profile compression settings
+	 * @param error receives the reason on failure
+	 * @return false on errors
+	 */
+	bool Open(const std::string& filename, int width, int height, const PngProfile& profile,
+		std::string& error);
+
+	/** Writes all rows of band, the width must match the image. */
+	bool WriteBand(const BlitSurface& band, std::string& error);
+
+	/** Writes the PNG end and closes the file. */
+	bool Finish(std::string& error);
+
+private:
+	void Close(bool remove_file);
+
+	std::string filename;
+	FILE *file = nullptr;
+	png_structp png_ptr = nullptr;
+	png_infop info_ptr = nullptr;
+};
+
+#endif
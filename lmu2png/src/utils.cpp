@@ -21,18 +21,85 @@
 #include <fstream>
 #include <string>
 #include <algorithm>
+#include <cctype>
+#include <filesystem>
 #include <map>
+#include <thread>
+#include <unordered_map>
 #include <lcf/ldb/reader.h>
 #include <lcf/lmu/reader.h>
 #include <lcf/reader_lcf.h>
 #include <lcf/rpg/map.h>
 #include <lcf/rpg/chipset.h>
 #include "utils.h"
+#include "assets.h"
+#include "atlascache.h"
+#include "background.h"
+#include "blit.h"
 #include "chipset.h"
+#include "compositor.h"
+#include "jobpool.h"
+#include "xyzplugin.h"
+
+namespace fs = std::filesystem;
+
+// Image files below the resource directories, see CollectResourcePaths
+struct ResourceEntry {
+	std::string path;
+	// lower is preferred: directory order, then extension order
+	int rank;
+};
+static std::vector<std::string> resource_dirs = {};
+static std::unordered_map<std::string, ResourceEntry> resource_index;
+// modification times of the scanned directories, see ResourcesChanged
+static std::vector<std::pair<fs::path, fs::file_time_type>> resource_times;
+
+static std::string ToLower(std::string s) {
+	std::transform(s.begin(), s.end(), s.begin(),
+		[](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+	return s;
+}
 
-using CharsetCacheMap = std::map<std::string, BitmapPtr>;
+static std::string ResourceKey(const std::string& folder, const std::string& base_name) {
+	return ToLower(folder + "/" + base_name);
+}
 
-static std::vector<std::string> resource_dirs = {};
+static void IndexResources() {
+	const std::string extensions[] = {".png", ".bmp", ".xyz"};
+	resource_index.clear();
+	resource_times.clear();
+
+	for (size_t d = 0; d < resource_dirs.size(); d++) {
+		const std::string& dir = resource_dirs[d];
+		std::error_code ec;
+		resource_times.emplace_back(dir, fs::last_write_time(dir, ec));
+
+		for (fs::directory_iterator folder(dir, ec), end; !ec && folder != end; folder.increment(ec)) {
+			if (!folder->is_directory(ec)) {
+				continue;
+			}
+			std::string folder_name = folder->path().filename().string();
+			resource_times.emplace_back(folder->path(), fs::last_write_time(folder->path(), ec));
+
+			for (fs::directory_iterator file(folder->path(), ec); !ec && file != end; file.increment(ec)) {
+				const fs::path& path = file->path();
+				std::string ext = ToLower(path.extension().string());
+				auto found = std::find(std::begin(extensions), std::end(extensions), ext);
+				if (found == std::end(extensions)) {
+					continue;
+				}
+
+				int rank = static_cast<int>(d * 3 + (found - std::begin(extensions)));
+				auto& entry = resource_index[ResourceKey(folder_name, path.stem().string())];
+				if (entry.path.empty() || rank < entry.rank) {
+					entry = {dir + "/" + folder_name + "/" + path.filename().string(), rank};
+				}
+			}
+			// a broken folder does not stop the scan of its siblings
+			ec.clear();
+		}
+	}
+}
 
 std::string GetFileDirectory(const std::string& file) {
 	size_t found = file.find_last_of("/\\");
@@ -71,97 +138,37 @@ void CollectResourcePaths(std::string& main_path) {
 	if (rtp2k3_ptr) {
 		split_path(rtp2k3_ptr);
 	}
+
+	IndexResources();
 }
 
-std::string FindResource(const std::string& folder, const std::string& base_name) {
-	for (const auto& dir : resource_dirs) {
-		for (const auto& ext : {".png", ".bmp", ".xyz"}) {
-			if (Exists(dir + "/" + folder + "/" + base_name + ext))
-				return dir + "/" + folder + "/" + base_name + ext;
+bool ResourcesChanged() {
+	for (const auto& dir : resource_times) {
+		std::error_code ec;
+		if (fs::last_write_time(dir.first, ec) != dir.second) {
+			return true;
 		}
 	}
-
-	return "";
+	return false;
 }
 
-void CustomAlphaCombine(FIBITMAP *src, int sLeft, int sTop, FIBITMAP *dst, int dLeft, int dTop, int width, int height) {
-	if (!src || !dst) {
-		std::cout << "Source or Destination parameter undefined.\n";
-		return;
-	}
-
-	int sBpp = FreeImage_GetBPP(src);
-	int dBpp = FreeImage_GetBPP(dst);
-	if((sBpp != 32) || (dBpp != 32)) {
-		std::cout << "Source or Destination have wrong format.\n";
-		return;
-	}
-
-	int sWidth = FreeImage_GetWidth(src);
-	int sHeight = FreeImage_GetHeight(src);
-	int dWidth = FreeImage_GetWidth(dst);
-	int dHeight = FreeImage_GetHeight(dst);
-
-	// Sanitize src dims
-	if((sLeft < 0) || (sTop < 0) || (sLeft + width > sWidth) || (sTop + height > sHeight)) {
-		std::cout << "Source dimension error.\n";
-		return;
-	}
-
-	// Event special case: draw only part on borders
-	if(dLeft < 0) {
-		int amount = dLeft + width;
-		dLeft = 0;
-		width = amount;
-	}
-	if(dTop < 0) {
-		int amount = dTop + height;
-		dTop = 0;
-		height = amount;
-	}
-	if(dLeft + width > dWidth) {
-		int amount = dLeft + width - dWidth;
-		width -= amount;
-	}
-	if(dTop + height > dHeight) {
-		int amount = dTop + height - dHeight;
-		height -= amount;
-	}
-
-	// Sanitize final dims
-	if ((width <= 0) || (height <= 0)) {
-		std::cout << "Skipping zero/negative size copy.\n";
-		return;
-	}
-
-	int bytespp = sBpp / 8;
-	for(int y = 0; y < height; y++) {
-		// set position to upper left corner
-		BYTE *src_bits = FreeImage_GetScanLine(src, sHeight - 1 - (sTop + y)) + sLeft * bytespp;
-		BYTE *dst_bits = FreeImage_GetScanLine(dst, dHeight - 1 - (dTop + y)) + dLeft * bytespp;
-
-		for(int x = 0; x < width; x++) {
-			// skip fully transparent pixels
-			if (src_bits[FI_RGBA_ALPHA] != 0) {
-				dst_bits[FI_RGBA_RED]   = src_bits[FI_RGBA_RED];
-				dst_bits[FI_RGBA_GREEN] = src_bits[FI_RGBA_GREEN];
-				dst_bits[FI_RGBA_BLUE]  = src_bits[FI_RGBA_BLUE];
-				dst_bits[FI_RGBA_ALPHA] = src_bits[FI_RGBA_ALPHA];
-			}
+std::string FindResource(const std::string& folder, const std::string& base_name) {
+	auto it = resource_index.find(ResourceKey(folder, base_name));
 
-			// next pixel
-			src_bits += bytespp;
-			dst_bits += bytespp;
-		}
-	}
+	return it == resource_index.end() ? "" : it->second.path;
 }
 
-FIBITMAP* LoadImage(std::string &image_path, bool transparent = false) {
+FIBITMAP* LoadImage(const std::string& image_path, bool transparent) {
 	BitmapPtr image;
 
 	FREE_IMAGE_FORMAT format = FreeImage_GetFileType(image_path.c_str());
 	if (format != FIF_UNKNOWN) {
-		image.reset(FreeImage_Load(format, image_path.c_str()));
+		if (format == FreeImage_GetFIFFromFormat("XYZ")) {
+			// decode straight from a memory mapping
+			image.reset(LoadXYZ(image_path.c_str()));
+		} else {
+			image.reset(FreeImage_Load(format, image_path.c_str()));
+		}
 	}
 
 	if (!image) {
@@ -180,99 +187,31 @@ FIBITMAP* LoadImage(std::string &image_path, bool transparent = false) {
 	return output;
 }
 
-void DrawTiles(FIBITMAP* output_img, Chipset* gen, uint8_t * csflag, std::unique_ptr<lcf::rpg::Map> & map, L2IConfig conf, LAYER flaglayer) {
-	for (int y = 0; y < map->height; ++y) {
-		for (int x = 0; x < map->width; ++x) {
-			// Different logic between these.
-			int tindex = x + y * map->width;
-
-			if (!conf.no_lowertiles) {
-				uint16_t tid = map->lower_layer[tindex];
-				LAYER l = (csflag[tid] & 0x30) ? LAYER::UPPER : LAYER::LOWER;
-				if (l == flaglayer)
-					gen->RenderTile(output_img, x, y, map->lower_layer[x+y*map->width], 0);
-			}
-
-			if (!conf.no_uppertiles) {
-				uint16_t tid = map->upper_layer[tindex];
-				LAYER l = (csflag[tid] & 0x10) ? LAYER::UPPER : LAYER::LOWER;
-				if (l == flaglayer)
-					gen->RenderTile(output_img, x, y, map->upper_layer[x+y*map->width], 0);
-			}
-		}
-	}
-}
-
-void DrawEvents(FIBITMAP* output_img, Chipset* gen, std::unique_ptr<lcf::rpg::Map> & map, LAYER layer, CharsetCacheMap &charsets, L2IConfig conf) {
-	for (const lcf::rpg::Event& ev : map->events) {
-		const lcf::rpg::EventPage* evp = nullptr;
+std::unique_ptr<Chipset> LoadChipset(const L2IConfig& conf) {
+	std::unique_ptr<Chipset> gen;
+	std::unique_ptr<AtlasCache> cache;
+	std::string entry;
 
-		if (conf.ignore_conditions) {
-			evp = &ev.pages[0];
+	if (!conf.cache.empty() && !conf.chipset.empty()) {
+		std::string error;
+		cache = std::make_unique<AtlasCache>(conf.cache);
+		if (cache->Init(error)) {
+			entry = cache->GetEntry(conf.chipset);
 		} else {
-			// Find highest page without conditions
-			for (int i = 0; i < (int)ev.pages.size(); ++i) {
-				const auto& flg = ev.pages[i].condition.flags;
-				if (flg.switch_a || flg.switch_b || flg.variable || flg.item || flg.actor || flg.timer || flg.timer2)
-					continue;
-				evp = &ev.pages[i];
-			}
-		}
-		if (!evp) {
-			continue;
+			std::cout << error << "\n";
 		}
+	}
 
-		// Event layering
-		if (evp->layer >= static_cast<int>(LAYER::LOWER)
-			&& evp->layer <= static_cast<int>(LAYER::EVENTS)
-			&& evp->layer != static_cast<int>(layer))
-			continue;
-
-		if (evp->character_name.empty()) {
-			gen->RenderTile(output_img, ev.x, ev.y, TILETYPE::UPPER + evp->character_index, 0);
-		} else {
-			std::string cname = lcf::ToString(evp->character_name);
-			if(charsets.count(cname) == 0) {
-				if(conf.verbose) {
-					std::cerr << "Loading CharSet \"" << cname << "\"\n";
-				}
-
-				std::string charset{FindResource("CharSet", cname)};
-				if (charset.empty()) {
-					std::cout << "Charset \"" << evp->character_name << "\" not found.\n";
-					continue;
-				}
-
-				// add image to cache
-				BitmapPtr charset_img{LoadImage(charset, true)};
-				if(charset_img) {
-					charsets.emplace(cname, std::move(charset_img));
-				}
-			} else {
-				// use from cache
-#ifndef NDEBUG
-				if(conf.verbose) {
-					std::cerr << "Using CharSet \"" << cname << "\" (cached)\n";
-				}
-#endif
-			}
-
-			int frame = evp->character_pattern;
-			if (conf.simulate_movement &&
-				(evp->animation_type == 0 || evp->animation_type == 2 || evp->animation_type == 6)) {
-				// middle frame
-				frame = 1;
+	if (!entry.empty()) {
+		gen = cache->Lookup(entry);
+		if (gen) {
+			if(conf.verbose) {
+				std::cerr << "Using cached ChipSet atlas \"" << entry << "\"\n";
 			}
-
-			CustomAlphaCombine(charsets[cname].get(), (evp->character_index % 4) * 72 + frame * 24,
-				(evp->character_index / 4) * 128 + evp->character_direction * 32,
-				output_img, ev.x * TILE_SIZE-4, ev.y * TILE_SIZE-16, // Why -4 and -16?
-				24, 32);
+			return gen;
 		}
 	}
-}
 
-void RenderCore(FIBITMAP* output_img, uint8_t * csflag, std::unique_ptr<lcf::rpg::Map> & map, L2IConfig conf) {
 	BitmapPtr chipset_img;
 	if (!conf.chipset.empty()) {
 		chipset_img.reset(LoadImage(conf.chipset, true));
@@ -288,12 +227,21 @@ void RenderCore(FIBITMAP* output_img, uint8_t * csflag, std::unique_ptr<lcf::rpg
 			std::cout << "Unable to create empty chipset image.\n";
 			exit(EXIT_FAILURE);
 		}
+		entry.clear();
+	}
+	gen = std::make_unique<Chipset>(chipset_img.get());
+
+	if (!entry.empty()) {
+		cache->Store(entry, *gen);
 	}
-	Chipset gen(chipset_img.get());
 
+	return gen;
+}
+
+void DrawBackground(FIBITMAP* output_img, const lcf::rpg::Map& map, const L2IConfig& conf, Assets& assets) {
 	// Draw parallax background
 	if (!conf.no_background) {
-		std::string pname = lcf::ToString(map->parallax_name);
+		std::string pname = lcf::ToString(map.parallax_name);
 		if (pname.empty()) {
 			if(conf.verbose) {
 				std::cerr << "Using black background.\n";
@@ -302,49 +250,115 @@ void RenderCore(FIBITMAP* output_img, uint8_t * csflag, std::unique_ptr<lcf::rpg
 			// Fill screen with black
 			RGBQUAD black{0, 0, 0, 0xFF};
 			FreeImage_FillBackground(output_img, &black);
+		} else if (conf.repeat_panorama) {
+			// Fill screen with repeated background
+			std::shared_ptr<FIBITMAP> background_img = assets.GetPanorama(pname, conf.verbose);
+			BlitSurface output(output_img);
+			Background background(output.width, output.height);
+			if (background_img && background.SetTiledPanorama(background_img)) {
+				background.DrawBand(output, 0);
+			}
 		} else {
-			if(conf.verbose) {
-				std::cerr << "Loading Panorama \"" << pname << "\"\n";
+			// Fill screen with scaled background
+			int dw = FreeImage_GetWidth(output_img);
+			int dh = FreeImage_GetHeight(output_img);
+			std::shared_ptr<FIBITMAP> scaled = assets.GetScaledPanorama(pname, dw, dh, conf.verbose);
+			if (scaled) {
+				FreeImage_Paste(output_img, scaled.get(), 0, 0, 256);
+
+				//FreeImage_Save(FIF_PNG, scaled.get(), "_back.png");
 			}
+		}
+	}
+}
 
-			std::string background{FindResource("Panorama", pname)};
-			if (background.empty()) {
-				std::cout << "Parallax background \"" << pname << "\" not found.\n";
-			} else {
-				BitmapPtr background_img{LoadImage(background)};
+void RenderCore(FIBITMAP* output_img, uint8_t * csflag, std::unique_ptr<lcf::rpg::Map> & map, L2IConfig conf, Assets& assets) {
+	std::shared_ptr<Chipset> gen = assets.GetChipset(conf);
 
-				// Fill screen with scaled background
-				int dw = FreeImage_GetWidth(output_img);
-				int dh = FreeImage_GetHeight(output_img);
-				BitmapPtr scaled{FreeImage_Rescale(background_img.get(), dw, dh, FILTER_BICUBIC)};
-				FreeImage_Paste(output_img, scaled.get(), 0, 0, 256);
+	DrawBackground(output_img, *map, conf, assets);
 
-				//FreeImage_Save(FIF_PNG, scaled.get(), "_back.png");
+	// Draw tiles and events
+	Compositor compositor(*gen, conf);
+	compositor.Build(*map, csflag, assets);
+	compositor.Draw(output_img, conf.threads);
+}
+
+bool RenderBands(uint8_t * csflag, std::unique_ptr<lcf::rpg::Map> & map, L2IConfig conf, Assets& assets,
+	const std::function<bool(const BlitSurface& band)>& write_band) {
+	std::shared_ptr<Chipset> gen = assets.GetChipset(conf);
+	int width = map->width * TILE_SIZE;
+	int height = map->height * TILE_SIZE;
+
+	// Prepare parallax background
+	Background background(width, height);
+	if (!conf.no_background) {
+		std::string pname = lcf::ToString(map->parallax_name);
+		if (pname.empty()) {
+			if(conf.verbose) {
+				std::cerr << "Using black background.\n";
+			}
+
+			background.SetColor({0, 0, 0, 0xFF});
+		} else if (conf.repeat_panorama) {
+			std::shared_ptr<FIBITMAP> background_img = assets.GetPanorama(pname, conf.verbose);
+			if (background_img) {
+				background.SetTiledPanorama(background_img);
+			}
+		} else {
+			// scaled to the map width here, to the height per band
+			std::shared_ptr<FIBITMAP> background_img = assets.GetScaledPanorama(pname, width, 0, conf.verbose);
+			if (background_img && !background.SetPanorama(background_img)) {
+				std::cout << "Unable to scale Panorama \"" << pname << "\".\n";
 			}
 		}
 	}
 
-	CharsetCacheMap charsets;
+	Compositor compositor(*gen, conf);
+	compositor.Build(*map, csflag, assets);
 
-	// Draw below tile layer
-	if (!(conf.no_lowertiles && conf.no_uppertiles)) {
-		DrawTiles(output_img, &gen, csflag, map, conf, LAYER::LOWER);
+	// One band buffer per thread, a round draws them in parallel and writes them in order
+	unsigned int threads = conf.threads;
+	if (threads == 0) {
+		threads = std::max(1u, std::thread::hardware_concurrency());
 	}
-	// Draw below-player & player-level events
-	if (!conf.no_events) {
-		DrawEvents(output_img, &gen, map, LAYER::LOWER, charsets, conf);
-		DrawEvents(output_img, &gen, map, LAYER::UPPER, charsets, conf);
+	int bands = (height + Compositor::BAND_HEIGHT - 1) / Compositor::BAND_HEIGHT;
+	std::vector<BitmapPtr> buffers(std::min<size_t>(threads, std::max(bands, 1)));
+	for (auto& buffer : buffers) {
+		buffer.reset(FreeImage_Allocate(width, Compositor::BAND_HEIGHT, 32));
+		if (!buffer) {
+			std::cout << "Unable to create band image.\n";
+			return false;
+		}
 	}
-	// Draw above tile layer
-	if (!(conf.no_lowertiles && conf.no_uppertiles)) {
-		DrawTiles(output_img, &gen, csflag, map, conf, LAYER::UPPER);
+
+	std::unique_ptr<JobPool> pool;
+	if (buffers.size() > 1) {
+		pool = std::make_unique<JobPool>(static_cast<unsigned int>(buffers.size()));
 	}
-	// Draw events
-	if (!conf.no_events) {
-		DrawEvents(output_img, &gen, map, LAYER::EVENTS, charsets, conf);
+
+	std::vector<BlitSurface> views(buffers.size());
+	for (int first = 0; first < bands; first += static_cast<int>(buffers.size())) {
+		size_t count = std::min(buffers.size(), static_cast<size_t>(bands - first));
+		auto draw_band = [&](size_t i) {
+			int top = (first + static_cast<int>(i)) * Compositor::BAND_HEIGHT;
+			views[i] = BlitSurface(buffers[i].get());
+			views[i].height = std::min(Compositor::BAND_HEIGHT, height - top);
+			background.DrawBand(views[i], top);
+			compositor.DrawBand(views[i], top);
+		};
+
+		if (pool) {
+			pool->ParallelFor(count, draw_band);
+		} else {
+			draw_band(0);
+		}
+
+		for (size_t i = 0; i < count; i++) {
+			if (!write_band(views[i])) {
+				return false;
+			}
+		}
 	}
 
-	//for(auto &kv : charsets) {
-	//	FreeImage_Save(FIF_PNG, kv.second.get(), std::string("_cs_" + kv.first + ".png").c_str());
-	//}
+	return true;
 }
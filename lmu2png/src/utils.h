@@ -25,12 +25,15 @@
 #include <algorithm>
 #include <lcf/rpg/map.h>
 #include <FreeImage.h>
+#include <functional>
 #include <memory>
 #include "main.h"
 
 // forward declarations
 
+struct BlitSurface;
 struct Chipset;
+class Assets;
 
 // type and other definitions
 
@@ -51,22 +54,29 @@ std::string GetFileDirectory(const std::string& file);
 
 bool Exists(const std::string& filename);
 
+// Sets the game and RTP directories and indexes the images below them once
 void CollectResourcePaths(std::string& main_path);
 
-std::string FindResource(const std::string& folder, const std::string& base_name);
+// Whether images were added or removed since the index was built
+bool ResourcesChanged();
 
-void CustomAlphaCombine(FIBITMAP *src, int sLeft, int sTop, FIBITMAP *dst, int dLeft,
-	int dTop, int width, int height);
+// Looks up an image in the index, folder and name are not case sensitive
+std::string FindResource(const std::string& folder, const std::string& base_name);
 
-FIBITMAP* LoadImage(const char* image_path, bool transparent = false);
+FIBITMAP* LoadImage(const std::string& image_path, bool transparent = false);
 
-void DrawTiles(FIBITMAP* output_img, Chipset * gen, uint8_t * csflag,
-	std::unique_ptr<lcf::rpg::Map> & map, L2IConfig conf, LAYER flaglayer);
+std::unique_ptr<Chipset> LoadChipset(const L2IConfig& conf);
 
-void DrawEvents(FIBITMAP* output_img, Chipset * gen,
-	std::unique_ptr<lcf::rpg::Map> & map, LAYER layer);
+// Fills the output with the background selected in conf
+void DrawBackground(FIBITMAP* output_img, const lcf::rpg::Map& map, const L2IConfig& conf,
+	Assets& assets);
 
 void RenderCore(FIBITMAP* output_img, uint8_t * csflag,
-	std::unique_ptr<lcf::rpg::Map> & map, L2IConfig conf);
+	std::unique_ptr<lcf::rpg::Map> & map, L2IConfig conf, Assets& assets);
+
+// Renders the map without allocating the full image, write_band receives
+// the bands from top to bottom and returns false to stop on errors
+bool RenderBands(uint8_t * csflag, std::unique_ptr<lcf::rpg::Map> & map, L2IConfig conf,
+	Assets& assets, const std::function<bool(const BlitSurface& band)>& write_band);
 
 #endif
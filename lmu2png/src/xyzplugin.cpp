@@ -17,7 +17,8 @@
 #include "xyzplugin.h"
 #include <cstring>
 #include <cstdio>
-#include <zlib.h>
+#include "mappedfile.h"
+#include "xyzreader.h"
 
 // for internal use
 
@@ -64,41 +65,18 @@ static BOOL Validate(FreeImageIO *io, fi_handle handle) {
 	return (memcmp(xyz_signature, signature, sizeof(xyz_signature)) == 0);
 }
 
-#ifdef FREEIMAGE_BIGENDIAN
-static inline void SwapShort(unsigned short *sp) {
-	unsigned char *cp = (unsigned char *)sp, t = cp[0];
-	cp[0] = cp[1];
-	cp[1] = t;
-}
-#endif
-
-static inline unsigned short ReadShort(FreeImageIO *io, fi_handle handle) {
-	unsigned short level = 0;
-	io->read_proc(&level, 2, 1, handle);
-#ifdef FREEIMAGE_BIGENDIAN
-	SwapShort(&level);
-#endif
-	return level;
-}
+// decode an opened image
 
-// load image
-
-static FIBITMAP *Load(FreeImageIO *io, fi_handle handle, int /* page */, int /* flags */, void */* data */) {
+static FIBITMAP *Decode(XyzReader &xyz, bool opened) {
 	FIBITMAP *dib = nullptr;
-	Bytef *compressedData = nullptr, *decompressedData = nullptr;
 	constexpr int paletteEntries = 256;
-	constexpr int paletteSize = paletteEntries * 3;
-
-	if (!handle)
-		return nullptr;
 
 	try {
-		// skip (already validated) magic
-		io->seek_proc(handle, 4, SEEK_CUR);
+		if (!opened)
+			throw xyz.GetError().c_str();
 
-		// get dimensions
-		int width = ReadShort(io, handle);
-		int height = ReadShort(io, handle);
+		int width = xyz.GetWidth();
+		int height = xyz.GetHeight();
 
 		// create a dib and write the bitmap header
 		dib = FreeImage_Allocate(width, height, 8);
@@ -106,63 +84,24 @@ static FIBITMAP *Load(FreeImageIO *io, fi_handle handle, int /* page */, int /*
 			throw "Failed to allocate memory for BITMAP.";
 		}
 
-		// get file size without header
-		io->seek_proc(handle, 0, SEEK_END);
-		long compressedDataSize = io->tell_proc(handle) - 8;
-		io->seek_proc(handle, 8, SEEK_SET);
-
-		uLongf total = paletteSize + (width * height);
-		uLongf totalBackup = total;
-
-		// Now the room for error has mostly ceded, allocate & fill buffers
-		compressedData = new Bytef[compressedDataSize];
-		if (!compressedData)
-			throw "Failed to allocate memory for file buffer.";
-
-		io->read_proc(compressedData, 1, compressedDataSize, handle);
-
-		decompressedData = new Bytef[total];
-		if (!decompressedData)
-			throw "Failed to allocate memory for decompression buffer.";
-
-		int status = uncompress(decompressedData, &total, compressedData, compressedDataSize);
-
-		if (totalBackup != total)
-			throw "Failed to uncompress image.";
-
-		if (status == Z_OK) {
-			// store the palette
-			RGBQUAD *palette = FreeImage_GetPalette(dib);
-			for(int i = 0; i < paletteEntries; i++) {
-				palette[i].rgbRed   = decompressedData[(i * 3) + 0];
-				palette[i].rgbGreen = decompressedData[(i * 3) + 1];
-				palette[i].rgbBlue  = decompressedData[(i * 3) + 2];
-			}
-
-			// copy in the bitmap bits via the pointer table
-			const BYTE* line = decompressedData + paletteSize;
-			for (int y = 0; y < height; y++) {
-				BYTE *dst_line = FreeImage_GetScanLine(dib, height - 1 - y);
-				memcpy(dst_line, line, width);
-
-				// advance to next
-				line += width;
-			}
+		// store the palette
+		const uint8_t *xyzPalette = xyz.GetPalette();
+		RGBQUAD *palette = FreeImage_GetPalette(dib);
+		for(int i = 0; i < paletteEntries; i++) {
+			palette[i].rgbRed   = xyzPalette[(i * 3) + 0];
+			palette[i].rgbGreen = xyzPalette[(i * 3) + 1];
+			palette[i].rgbBlue  = xyzPalette[(i * 3) + 2];
 		}
 
-		// cleanup
-		delete[] compressedData;
-		delete[] decompressedData;
+		// inflate the bitmap bits straight into the scanlines (stored bottom-up)
+		for (int y = 0; y < height; y++) {
+			if (!xyz.ReadRow(FreeImage_GetScanLine(dib, height - 1 - y)))
+				throw xyz.GetError().c_str();
+		}
 
 		return dib;
 
 	} catch (const char *text) {
-		// free zlib buffers
-		if(compressedData)
-			delete[] compressedData;
-		if(decompressedData)
-			delete[] decompressedData;
-
 		// free bitmap struct
 		if (dib) {
 			FreeImage_Unload(dib);
@@ -177,6 +116,35 @@ static FIBITMAP *Load(FreeImageIO *io, fi_handle handle, int /* page */, int /*
 	}
 }
 
+// load image
+
+static FIBITMAP *Load(FreeImageIO *io, fi_handle handle, int /* page */, int /* flags */, void */* data */) {
+	if (!handle)
+		return nullptr;
+
+	// header and palette, the image is inflated row by row
+	XyzReader xyz;
+	bool opened = xyz.Open([io, handle](uint8_t *buffer, size_t size) -> size_t {
+		return io->read_proc(buffer, 1, static_cast<unsigned>(size), handle);
+	});
+
+	return Decode(xyz, opened);
+}
+
+FIBITMAP *LoadXYZ(const char *filename) {
+	MappedFile file;
+	if (!file.Open(filename)) {
+		FreeImage_OutputMessageProc(s_format_id, "Failed to open file.");
+		return nullptr;
+	}
+
+	// zlib reads the mapping directly, no stream I/O copies
+	XyzReader xyz;
+	bool opened = xyz.Open(file.GetData(), file.GetSize());
+
+	return Decode(xyz, opened);
+}
+
 // finally describe the plugin
 
 void InitXYZ(Plugin *plugin, int format_id) {
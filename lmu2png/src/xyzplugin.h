@@ -21,4 +21,7 @@
 
 void InitXYZ(Plugin *plugin, int format_id);
 
+/** Loads a XYZ file through a memory mapping, bypassing FreeImage I/O. */
+FIBITMAP *LoadXYZ(const char *filename);
+
 #endif
@@ -22,235 +22,245 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
-#ifdef _WIN32
-# include <algorithm>
-#endif
+#include <vector>
+#include <argparse.hpp>
+#include "batch.h"
+#include "palette.h"
 
 # ifdef __MINGW64_VERSION_MAJOR
 int _dowildcard = -1; /* enable wildcard expansion for mingw-w64 */
 # endif
 
-/** Returns the filename (without extension). */
-std::string GetFilename(const std::string& str);
+/** Converts one PNG file, writes error messages to err. */
+static bool ConvertFile(const Batch::Job& job, bool sort_palette, std::ostream& err);
 
-/** Returns that path (everything left to the last /) */
-std::string GetPath(const std::string& str);
+int main(int argc, char* argv[]) {
+	std::vector<std::string> files;
+	std::string output_dir;
+	int jobs = 1;
+	bool update = false;
+	bool sort_palette = false;
+
+	argparse::ArgumentParser cli("png2xyz", PACKAGE_VERSION);
+	cli.set_usage_max_line_width(100);
+	cli.add_description("Convert PNG images into XYZ images.");
+	cli.add_epilog("Homepage " PACKAGE_URL " - Report bugs at: " PACKAGE_BUGREPORT);
+
+	cli.add_argument("FILE").nargs(argparse::nargs_pattern::at_least_one)
+		.store_into(files).help("PNG files or directories (searched recursively) to convert");
+	cli.add_argument("-o", "--output").store_into(output_dir).metavar("DIR")
+		.help("Write the XYZ files into DIR, directories are mirrored below it\n"
+			"(default: current directory)");
+	cli.add_argument("-j", "--jobs").store_into(jobs).metavar("N")
+		.help("Convert N files in parallel (0: one per CPU core, default: 1)");
+	cli.add_argument("-u", "--update").store_into(update)
+		.help("Skip files whose output is newer than the input");
+	cli.add_argument("-s", "--sort-palette").store_into(sort_palette)
+		.help("Reorder the palette (by frequency, luminance or colour\n"
+			"distance) when it makes the file smaller, index 0 is kept");
+
+	try {
+		cli.parse_args(argc, argv);
+	} catch (const std::exception& err) {
+		std::cerr << err.what() << "\n";
+		// print usage message
+		std::cerr << cli.usage() << "\n";
+		std::exit(EXIT_FAILURE);
+	}
+
+	if (jobs < 0) {
+		std::cerr << "Invalid amount of jobs: " << jobs << "\n";
+		std::exit(EXIT_FAILURE);
+	}
 
-std::string GetFilename(const std::string& str) {
-	std::string s = str;
-#ifdef _WIN32
-	std::replace(s.begin(), s.end(), '\\', '/');
-#endif
+	Batch::Options options;
+	options.input_extension = ".png";
+	options.output_extension = ".xyz";
+	options.output_directory = output_dir;
+	options.update = update;
+	options.threads = static_cast<unsigned int>(jobs);
 
-	// Extension
-	size_t found = s.find_last_of(".");
-	if(found != std::string::npos)
-	{
-		s = s.substr(0, found);
+	std::vector<Batch::Job> batch = Batch::Collect(files, options, std::cerr);
+	size_t failed = Batch::Run(batch, options, [sort_palette](const Batch::Job& job, std::ostream& err) {
+		return ConvertFile(job, sort_palette, err);
+	});
+
+	return failed == 0 ? 0 : 1;
+}
+
+static bool ConvertFile(const Batch::Job& job, bool sort_palette, std::ostream& err) {
+	const char* arg = job.input.c_str();
+	FILE *png_file;
+	unsigned char* header;
+	png_structp png_ptr;
+	png_infop info_ptr;
+	unsigned short width;
+	unsigned short height;
+	unsigned int bit_depth;
+	unsigned int color_type;
+	png_colorp palette;
+	int num_palette;
+	png_bytep *row_pointers;
+	std::vector<uint8_t> xyz_data;
+	uLong comp_size;
+	Bytef* comp_data;
+
+	// Open PNG file
+	png_file = fopen(arg, "rb");
+	if(png_file == NULL) {
+		err << "Error reading file "
+			<< arg << "." << std::endl;
+		return false;
 	}
 
-	// Filename
-	found = s.find_last_of("/");
-	if(found == std::string::npos)
-	{
-		return s;
+	// Read PNG file header
+	header = new unsigned char[8];
+	if (fread(header, 1, 8, png_file) != 8) {
+		err << "Error reading PNG header of file "
+			<< arg << "." << std::endl;
+		delete[] header;
+		fclose(png_file);
+		return false;
 	}
 
-	s = s.substr(found + 1);
-	return s;
-}
+	// Check PNG validity
+	if(png_sig_cmp(header, 0, 8) != 0) {
+		err << "Input file " << arg
+			<< " is not a PNG file." << std::endl;
+		delete[] header;
+		fclose(png_file);
+		return false;
+	}
+	delete[] header;
 
-std::string GetPath(const std::string& str) {
-	std::string s = str;
-#ifdef _WIN32
-	std::replace(s.begin(), s.end(), '\\', '/');
-#endif
-	// Path
-	size_t found = s.find_last_of("/");
-	if(found == std::string::npos)
+	// Create PNG read structure
+	png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL,
+		NULL, NULL);
+	if(png_ptr == NULL)
 	{
-		return ".";
+		err << "Error creating PNG read structure for "
+			<< arg << "." << std::endl;
+		fclose(png_file);
+		return false;
 	}
 
-	s = s.substr(0, found);
-	return s;
-}
+	// Create PNG info structure
+	info_ptr = png_create_info_struct(png_ptr);
+	if(info_ptr == NULL)
+	{
+		err << "Error creating PNG info structure for "
+			<< arg << "." << std::endl;
+		png_destroy_read_struct(&png_ptr, NULL, NULL);
+		fclose(png_file);
+		return false;
+	}
 
-int main(int argc, char* argv[]) {
-	if(argc < 2)
+	// Init I/O functions
+	if(setjmp(png_jmpbuf(png_ptr)))
 	{
-		std::cout << "Usage: " << argv[0]
-			<< " filename" << std::endl;
-		return 1;
+		err << "Error initializing PNG I/O for "
+			<< arg << "." << std::endl;
+		png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+		fclose(png_file);
+		return false;
 	}
+	png_init_io(png_ptr, png_file);
 
-	for(int arg = 1; arg < argc; arg++) {
-		FILE *png_file;
-		unsigned char* header;
-		png_structp png_ptr;
-		png_infop info_ptr;
-		unsigned short width;
-		unsigned short height;
-		unsigned int bit_depth;
-		unsigned int color_type;
-		png_colorp palette;
-		int num_palette;
-		png_bytep *row_pointers;
-		Bytef* xyz_data;
-		uLong comp_size;
-		Bytef* comp_data;
-		std::string xyz_filename;
-
-		// Open PNG file
-		png_file = fopen(argv[arg], "rb");
-		if(png_file == NULL) {
-			std::cerr << "Error reading file "
-				<< argv[arg] << "." << std::endl;
-			return 1;
-		}
-
-		// Read PNG file header
-		header = new unsigned char[8];
-		if (fread(header, 1, 8, png_file) != 8) {
-			std::cerr << "Error reading PNG header of file "
-				<< argv[arg] << "." << std::endl;
-			delete[] header;
-			return 1;
-		}
-
-		// Check PNG validity
-		if(png_sig_cmp(header, 0, 8) != 0) {
-			std::cerr << "Input file " << argv[arg]
-				<< " is not a PNG file." << std::endl;
-			delete[] header;
-			return 1;
-		}
-		delete[] header;
+	// Already read 8 header bytes, let libpng know about this
+	png_set_sig_bytes(png_ptr, 8);
 
-		// Create PNG read structure
-		png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL,
-			NULL, NULL);
-		if(png_ptr == NULL)
-		{
-			std::cerr << "Error creating PNG read structure for "
-				<< argv[arg] << "." << std::endl;
-			fclose(png_file);
-			return 1;
-		}
-
-		// Create PNG info structure
-		info_ptr = png_create_info_struct(png_ptr);
-		if(info_ptr == NULL)
-		{
-			std::cerr << "Error creating PNG info structure for "
-				<< argv[arg] << "." << std::endl;
-			png_destroy_read_struct(&png_ptr, NULL, NULL);
-			fclose(png_file);
-			return 1;
-		}
-
-		// Init I/O functions
-		if(setjmp(png_jmpbuf(png_ptr)))
-		{
-			std::cerr << "Error initializing PNG I/O for "
-				<< argv[arg] << "." << std::endl;
-			png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
-			fclose(png_file);
-			return 1;
-		}
-		png_init_io(png_ptr, png_file);
-
-		// Already read 8 header bytes, let libpng know about this
-		png_set_sig_bytes(png_ptr, 8);
-
-		// Read PNG
-		png_read_png(png_ptr, info_ptr, PNG_TRANSFORM_IDENTITY, NULL);
-
-		// Check PNG dimensions
-		width = png_get_image_width(png_ptr, info_ptr);
-		height = png_get_image_height(png_ptr, info_ptr);
-
-		// Check bit depth validity
-		bit_depth = png_get_bit_depth(png_ptr, info_ptr);
-		if(bit_depth != 8) {
-			std::cerr << "PNG file " << argv[arg]
-				<< " is not using 8 bit depth." << std::endl;
-			png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
-			fclose(png_file);
-			return 1;
-		}
-
-		// Check color type validity
-		color_type = png_get_color_type(png_ptr, info_ptr);
-		if(color_type != PNG_COLOR_TYPE_PALETTE) {
-			std::cerr << "PNG file " << argv[arg]
-				<< " is not palette based." << std::endl;
-			png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
-			fclose(png_file);
-			return 1;
-		}
-
-		// Check palette chunk validity
-		if(png_get_valid(png_ptr, info_ptr, PNG_INFO_PLTE) == 0) {
-			std::cerr << "PNG file " << argv[arg]
-				<< " has an invalid palette chunk."
-				<< std::endl;
-			png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
-			fclose(png_file);
-			return 1;
-		}
-
-		// Get palette and color count
-		png_get_PLTE(png_ptr, info_ptr, &palette, &num_palette);
-
-		xyz_data = new unsigned char[768 + width * height];
-		memset(xyz_data, 0, 768);
-
-		// Create XYZ palette
-		for (int i = 0; i < num_palette; i++) {
-			xyz_data[i * 3] = palette[i].red;
-			xyz_data[i * 3 + 1] = palette[i].green;
-			xyz_data[i * 3 + 2] = palette[i].blue;
-		}
-
-		// Get image rows
-		row_pointers = png_get_rows(png_ptr, info_ptr);
-
-		// Create XYZ image
-		for (size_t y = 0; y < height; y++) {
-			memcpy(&xyz_data[768 + y * width],
-			row_pointers[y], width);
-		}
-
-		// Close PNG file
+	// Read PNG
+	png_read_png(png_ptr, info_ptr, PNG_TRANSFORM_IDENTITY, NULL);
+
+	// Check PNG dimensions
+	width = png_get_image_width(png_ptr, info_ptr);
+	height = png_get_image_height(png_ptr, info_ptr);
+
+	// Check bit depth validity
+	bit_depth = png_get_bit_depth(png_ptr, info_ptr);
+	if(bit_depth != 8) {
+		err << "PNG file " << arg
+			<< " is not using 8 bit depth." << std::endl;
+		png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+		fclose(png_file);
+		return false;
+	}
+
+	// Check color type validity
+	color_type = png_get_color_type(png_ptr, info_ptr);
+	if(color_type != PNG_COLOR_TYPE_PALETTE) {
+		err << "PNG file " << arg
+			<< " is not palette based." << std::endl;
 		png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
 		fclose(png_file);
+		return false;
+	}
+
+	// Check palette chunk validity
+	if(png_get_valid(png_ptr, info_ptr, PNG_INFO_PLTE) == 0) {
+		err << "PNG file " << arg
+			<< " has an invalid palette chunk."
+			<< std::endl;
+		png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+		fclose(png_file);
+		return false;
+	}
+
+	// Get palette and color count
+	png_get_PLTE(png_ptr, info_ptr, &palette, &num_palette);
 
-		// Compress XYZ data
-		comp_size = compressBound(768 + width * height);
-		comp_data = new Bytef[comp_size];
-
-		int errorcode = compress2(comp_data, &comp_size, xyz_data,
-			768 + width * height, Z_BEST_COMPRESSION);
-		delete[] xyz_data;
-		if(errorcode != Z_OK) {
-			std::cerr << "Error while compressing XYZ data from "
-				<< argv[arg] << "." << std::endl;
-			delete[] comp_data;
-			return 1;
-		}
-
-		std::stringstream ss;
-		ss << GetFilename(argv[arg]) + std::string(".xyz");
-		xyz_filename = ss.str();
-		std::ofstream xyz_file(xyz_filename.c_str(), std::ofstream::binary);
-		xyz_file.write("XYZ1", 4);
-		xyz_file.write(reinterpret_cast<char*>(&width), 2);
-		xyz_file.write(reinterpret_cast<char*>(&height), 2);
-		xyz_file.write(reinterpret_cast<char*>(comp_data), comp_size);
-		xyz_file.close();
+	xyz_data.assign(768 + width * height, 0);
+
+	// Create XYZ palette
+	for (int i = 0; i < num_palette; i++) {
+		xyz_data[i * 3] = palette[i].red;
+		xyz_data[i * 3 + 1] = palette[i].green;
+		xyz_data[i * 3 + 2] = palette[i].blue;
+	}
+
+	// Get image rows
+	row_pointers = png_get_rows(png_ptr, info_ptr);
+
+	// Create XYZ image
+	for (size_t y = 0; y < height; y++) {
+		memcpy(&xyz_data[768 + y * width],
+		row_pointers[y], width);
+	}
+
+	// Close PNG file
+	png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
+	fclose(png_file);
+
+	if (sort_palette) {
+		Palette::Optimize(xyz_data);
+	}
+
+	// Compress XYZ data
+	comp_size = compressBound(768 + width * height);
+	comp_data = new Bytef[comp_size];
+
+	int errorcode = compress2(comp_data, &comp_size, xyz_data.data(),
+		xyz_data.size(), Z_BEST_COMPRESSION);
+	if(errorcode != Z_OK) {
+		err << "Error while compressing XYZ data from "
+			<< arg << "." << std::endl;
 		delete[] comp_data;
+		return false;
+	}
+
+	std::ofstream xyz_file(job.output, std::ofstream::binary);
+	xyz_file.write("XYZ1", 4);
+	xyz_file.write(reinterpret_cast<char*>(&width), 2);
+	xyz_file.write(reinterpret_cast<char*>(&height), 2);
+	xyz_file.write(reinterpret_cast<char*>(comp_data), comp_size);
+	xyz_file.close();
+	delete[] comp_data;
+
+	if(!xyz_file) {
+		err << "Error writing file "
+			<< job.output << "." << std::endl;
+		return false;
 	}
 
-	return 0;
+	return true;
 }
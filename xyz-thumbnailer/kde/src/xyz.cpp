@@ -11,54 +11,49 @@
 
 #include <QString>
 #include <QImage>
-#include <zlib.h>
+#include <vector>
 
-bool XyzImage::toImage(char* data, size_t size, QImage &img) {
-	if (strncmp((char *) data, "XYZ1", 4) != 0) {
-		return false;
-	}
-
-	unsigned short w;
-	memcpy(&w, &data[4], 2);
-	unsigned short h;
-	memcpy(&h, &data[6], 2);
-
-	uLongf src_size = (uLongf)(size - 8);
-	Bytef* src_buffer = (Bytef*)&data[8];
-	uLongf dst_size = 768 + (w * h);
-	std::vector<Bytef> dst_buffer(dst_size);
+namespace {
+	bool decode(XyzReader& xyz, QImage &img) {
+		int w = xyz.GetWidth();
+		int h = xyz.GetHeight();
+		const uint8_t (*palette)[3] = (const uint8_t(*)[3]) xyz.GetPalette();
 
-	int status = uncompress(&dst_buffer.front(), &dst_size, src_buffer, src_size);
+		QImage q(w, h, QImage::Format_ARGB32);
+		if (q.isNull()) {
+			return false;
+		}
 
-	free(data);
+		std::vector<uint8_t> row(w);
+		for (int y = 0; y < h; y++) {
+			if (!xyz.ReadRow(row.data())) {
+				return false;
+			}
+
+			QRgb* dst = (QRgb*) q.scanLine(y);
+			for (int x = 0; x < w; x++) {
+				const uint8_t* color = palette[row[x]];
+				dst[x] = qRgb(color[0], color[1], color[2]);
+			}
+		}
+		img = q;
 
-	if (status != Z_OK) {
-		return false;
+		return !img.isNull();
 	}
-	const uint8_t (*palette)[3] = (const uint8_t(*)[3]) &dst_buffer.front();
-
-	void* pixels = malloc(w * h * 4);
+}
 
-	if (!pixels) {
+bool XyzImage::toImage(const XyzReader::ReadFunc& read, QImage &img) {
+	XyzReader xyz;
+	if (!xyz.Open(read)) {
 		return false;
 	}
+	return decode(xyz, img);
+}
 
-	uint8_t* dst = (uint8_t*) pixels;
-	const uint8_t* src = (const uint8_t*) &dst_buffer[768];
-	for (int y = 0; y < h; y++) {
-		for (int x = 0; x < w; x++) {
-			uint8_t pix = *src++;
-			const uint8_t* color = palette[pix];
-			*dst++ = color[2];
-			*dst++ = color[1];
-			*dst++ = color[0];
-			*dst++ = 255;
-		}
+bool XyzImage::toImage(const uint8_t* data, size_t size, QImage &img) {
+	XyzReader xyz;
+	if (!xyz.Open(data, size)) {
+		return false;
 	}
-	QImage q((uchar*)pixels, w, h, QImage::Format_ARGB32);
-	img = q;
-
-	// pixels owned by QImage
-
-	return !img.isNull();
+	return decode(xyz, img);
 }
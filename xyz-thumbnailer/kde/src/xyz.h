@@ -11,10 +11,15 @@
 #define XYZ_H
 
 #include <QImage>
+#include "xyzreader.h"
 
 // Shared code for creating a XYZ QImage
 namespace XyzImage {
-	bool toImage(char* xyz_buf, size_t size, QImage &img);
+	// Decodes row by row from the callback, the file is never fully buffered
+	bool toImage(const XyzReader::ReadFunc& read, QImage &img);
+
+	// Decodes from memory, e.g. a mapped file
+	bool toImage(const uint8_t* data, size_t size, QImage &img);
 }
 
 #endif // XYZ_H
@@ -12,7 +12,7 @@
 
 #include <QString>
 #include <QImage>
-#include <zlib.h>
+#include <QFileDevice>
 
 QImageIOHandler* XyzImageIOPlugin::create(QIODevice *device, const QByteArray &format) const {
 	if (format.isNull() || format.toLower() == "xyz") {
@@ -62,21 +62,24 @@ bool XyzImageIOHandler::read(QImage* image) {
 		 return false;
 	}
 
-	qint64 fsize = device()->size();
-
-	if (fsize <= 8 || fsize > 1024*1024*1024) {
-		return false;
-	}
-
-	char* data = (char*)malloc(fsize);
-	if (!data) {
-		return false;
-	}
-
-	qint64 res = device()->read(data, fsize);
-	if (res != fsize) {
-		return false;
+	QIODevice* dev = device();
+
+	// Local files: inflate straight from a memory mapping
+	QFileDevice* file = qobject_cast<QFileDevice*>(dev);
+	if (file && !file->isSequential()) {
+		qint64 pos = file->pos();
+		qint64 size = file->size() - pos;
+		uchar* data = size > 0 ? file->map(pos, size) : nullptr;
+		if (data) {
+			bool ok = XyzImage::toImage(data, (size_t)size, *image);
+			file->unmap(data);
+			file->seek(pos + size);
+			return ok;
+		}
 	}
 
-	return XyzImage::toImage(data, fsize, *image);
+	return XyzImage::toImage([dev](uint8_t* buffer, size_t size) -> size_t {
+		qint64 res = dev->read((char*)buffer, size);
+		return res > 0 ? (size_t)res : 0;
+	}, *image);
 }
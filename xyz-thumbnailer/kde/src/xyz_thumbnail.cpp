@@ -9,10 +9,10 @@
 
 #include "xyz_thumbnail.h"
 #include "xyz.h"
+#include "mappedfile.h"
 
 #include <QString>
 #include <QImage>
-#include <zlib.h>
 
 #include <KPluginFactory>
 
@@ -28,34 +28,18 @@ XyzThumbnailCreator::~XyzThumbnailCreator()
 }
 
 KIO::ThumbnailResult XyzThumbnailCreator::create(const KIO::ThumbnailRequest &request) {
-	FILE* f = fopen(request.url().toLocalFile().toUtf8().data(), "rb");
-	if (!f) {
-		KIO::ThumbnailResult::fail();
+	MappedFile file;
+	if (!file.Open(request.url().toLocalFile().toStdString())) {
+		return KIO::ThumbnailResult::fail();
 	}
 
-	fseek(f, 0, SEEK_END);
-	size_t size = ftell(f);
-	fseek(f, 0, SEEK_SET);
-
-	if (size <= 8 || size > 1024*1024*1024) {
-		fclose(f);
-		KIO::ThumbnailResult::fail();
-	}
-
-	char* data = (char*)malloc(size);
-	if (!data) {
-		fclose(f);
-		KIO::ThumbnailResult::fail();
-	}
+	// inflate straight from the mapped file
+	QImage img;
+	bool ok = XyzImage::toImage(file.GetData(), file.GetSize(), img);
 
-	size_t res = fread(data, size, 1, f);
-	if (res != 1) {
-		KIO::ThumbnailResult::fail();
+	if (!ok) {
+		return KIO::ThumbnailResult::fail();
 	}
-	fclose(f);
-
-	QImage img;
-	XyzImage::toImage(data, size, img);
 	return KIO::ThumbnailResult::pass(img);
 }
 
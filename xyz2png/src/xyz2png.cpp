@@ -22,221 +22,297 @@
 #include <fstream>
 #include <vector>
 #include <sstream>
-#ifdef _WIN32
-# include <algorithm>
-#endif
+#include <thread>
+#include <argparse.hpp>
+#include "batch.h"
+#include "mappedfile.h"
+#include "pngprofile.h"
+#include "rowring.h"
+#include "xyzreader.h"
 
 # ifdef __MINGW64_VERSION_MAJOR
 int _dowildcard = -1; /* enable wildcard expansion for mingw-w64 */
 # endif
 
-/** Returns the filename (without extension). */
-std::string GetFilename(const std::string& str);
+/** Converts one XYZ file, writes error messages to err. */
+static bool ConvertFile(const Batch::Job& job, const PngProfile& profile, bool pipeline,
+	std::ostream& err);
 
-/** Returns that path (everything left to the last /) */
-std::string GetPath(const std::string& str);
+/**
+ * Inflates the remaining rows and passes them to png_write_row.
+ * With pipeline set the inflating happens on a second thread.
+ *
+ * @return false on XYZ or PNG errors, error contains the reason
+ */
+static bool WriteRows(png_structp png_ptr, XyzReader& xyz, bool pipeline,
+	std::string& error);
 
-std::string GetFilename(const std::string& str) {
-	std::string s = str;
-#ifdef _WIN32
-	std::replace(s.begin(), s.end(), '\\', '/');
-#endif
+static bool WriteRows(png_structp png_ptr, XyzReader& xyz, bool pipeline,
+	std::string& error) {
+	int width = xyz.GetWidth();
+	int height = xyz.GetHeight();
 
-	// Extension
-	size_t found = s.find_last_of(".");
-	if(found != std::string::npos)
-	{
-		s = s.substr(0, found);
+	if(!pipeline) {
+		std::vector<png_byte> row(width);
+		if(setjmp(png_jmpbuf(png_ptr))) {
+			error = "PNG write error";
+			return false;
+		}
+		for(int i = 0; i < height; i++) {
+			if(!xyz.ReadRow(row.data())) {
+				error = xyz.GetError();
+				return false;
+			}
+			png_write_row(png_ptr, row.data());
+		}
+		return true;
 	}
 
-	// Filename
-	found = s.find_last_of("/");
-	if(found == std::string::npos)
-	{
-		return s;
+	// A few rows of slack are enough to keep both threads busy
+	RowRing ring(width, 16);
+	bool decoded = true;
+	std::thread decoder([&ring, &xyz, &decoded, height]() {
+		for(int i = 0; i < height; i++) {
+			uint8_t* row = ring.BeginWrite();
+			if(!row) {
+				break;
+			}
+			if(!xyz.ReadRow(row)) {
+				decoded = false;
+				break;
+			}
+			ring.EndWrite();
+		}
+		ring.Close();
+	});
+
+	if(setjmp(png_jmpbuf(png_ptr))) {
+		ring.Abort();
+		decoder.join();
+		error = "PNG write error";
+		return false;
 	}
-
-	s = s.substr(found + 1);
-	return s;
-}
-
-std::string GetPath(const std::string& str) {
-	std::string s = str;
-#ifdef _WIN32
-	std::replace(s.begin(), s.end(), '\\', '/');
-#endif
-	// Path
-	size_t found = s.find_last_of("/");
-	if(found == std::string::npos)
-	{
-		return ".";
+	for(int i = 0; i < height; i++) {
+		const uint8_t* row = ring.BeginRead();
+		if(!row) {
+			break;
+		}
+		png_write_row(png_ptr, const_cast<png_bytep>(row));
+		ring.EndRead();
 	}
+	decoder.join();
 
-	s = s.substr(0, found);
-	return s;
+	if(!decoded) {
+		error = xyz.GetError();
+		return false;
+	}
+	return true;
 }
 
 int main(int argc, char* argv[]) {
-	if(argc < 2)
-	{
-		std::cout << "Usage: " << argv[0]
-			<< " filename" << std::endl;
-		return 1;
-	}
-
-	for(int arg = 1; arg < argc; arg++) {
-		std::ifstream file(argv[arg],
-			std::ios::binary | std::ios::ate);
-		if(!file) {
-			std::cerr << "Error reading file "
-				<< argv[arg] << "." << std::endl;
-			return 1;
-		}
-
-		long size = file.tellg();
-		char* header = new char[4];
-
-		file.seekg(0, std::ios::beg);
-		file.read((char*) header, 4);
-		if(memcmp(header, "XYZ1", 4) != 0) {
-			std::cerr << "Input file " << argv[arg]
-				<< " is not a XYZ file: '"
-				<< header << "'." << std::endl;
-			delete[] header;
-			return 1;
-		}
-		delete[] header;
+	std::vector<std::string> files;
+	std::string output_dir;
+	int jobs = 1;
+	bool update = false;
+	bool pipeline = false;
+	std::string profile_name = GetPngProfiles()[0].name;
+
+	argparse::ArgumentParser cli("xyz2png", PACKAGE_VERSION);
+	cli.set_usage_max_line_width(100);
+	cli.add_description("Convert XYZ images into PNG images.");
+	cli.add_epilog("Homepage " PACKAGE_URL " - Report bugs at: " PACKAGE_BUGREPORT);
+
+	cli.add_argument("FILE").nargs(argparse::nargs_pattern::at_least_one)
+		.store_into(files).help("XYZ files or directories (searched recursively) to convert");
+	cli.add_argument("-o", "--output").store_into(output_dir).metavar("DIR")
+		.help("Write the PNG files into DIR, directories are mirrored below it\n"
+			"(default: current directory)");
+	cli.add_argument("-j", "--jobs").store_into(jobs).metavar("N")
+		.help("Convert N files in parallel (0: one per CPU core, default: 1)");
+	cli.add_argument("-u", "--update").store_into(update)
+		.help("Skip files whose output is newer than the input");
+	cli.add_argument("-p", "--pipeline").store_into(pipeline)
+		.help("Inflate the XYZ data on a second thread while the PNG\n"
+			"data is compressed");
+	auto& profile_arg = cli.add_argument("-P", "--profile").store_into(profile_name)
+		.metavar("NAME").help(GetPngProfileHelp());
+	for (const auto& profile : GetPngProfiles()) {
+		profile_arg.add_choice(profile.name);
+	}
 
-		unsigned short width;
-		unsigned short height;
-		file.read((char*) &width, 2);
-		file.read((char*) &height, 2);
+	try {
+		cli.parse_args(argc, argv);
+	} catch (const std::exception& err) {
+		std::cerr << err.what() << "\n";
+		// print usage message
+		std::cerr << cli.usage() << "\n";
+		std::exit(EXIT_FAILURE);
+	}
 
-		int compressed_xyz_size = size - 8;
-		Bytef* compressed_xyz_data = new Bytef[compressed_xyz_size];
+	if (jobs < 0) {
+		std::cerr << "Invalid amount of jobs: " << jobs << "\n";
+		std::exit(EXIT_FAILURE);
+	}
 
-		file.read((char*) compressed_xyz_data, compressed_xyz_size);
+	const PngProfile* profile = FindPngProfile(profile_name);
 
-		uLongf xyz_size = 768 + (width * height);
-		std::vector<Bytef> xyz_data(
-			xyz_size);
+	Batch::Options options;
+	options.input_extension = ".xyz";
+	options.output_extension = ".png";
+	options.output_directory = output_dir;
+	options.update = update;
+	options.threads = static_cast<unsigned int>(jobs);
 
-		int status = uncompress(&xyz_data.front(),
-			&xyz_size, compressed_xyz_data,
-			compressed_xyz_size);
+	std::vector<Batch::Job> batch = Batch::Collect(files, options, std::cerr);
+	size_t failed = Batch::Run(batch, options,
+		[profile, pipeline](const Batch::Job& job, std::ostream& err) {
+			return ConvertFile(job, *profile, pipeline, err);
+		});
 
-		if(status != Z_OK) {
-			std::cerr << "Error uncompressing XYZ file "
-				<< argv[arg] << "." << std::endl;
-			return 1;
-		}
+	return failed == 0 ? 0 : 1;
+}
 
-		FILE *png_file;
-		png_structp png_ptr;
-		png_infop info_ptr;
-		std::string png_filename;
-		std::stringstream ss;
-
-		ss << GetFilename(argv[arg]) << ".png";
-		png_filename = ss.str();
-
-		// Open file for writing
-		png_file = fopen(png_filename.c_str(), "wb");
-		if(png_file == NULL) {
-			std::cerr << "Error creating file "
-				<< png_filename<< "." << std::endl;
-			return 1;
-		}
+static bool ConvertFile(const Batch::Job& job, const PngProfile& profile, bool pipeline,
+	std::ostream& err) {
+	const char* arg = job.input.c_str();
+	MappedFile file;
+	if(!file.Open(job.input)) {
+		err << "Error reading file "
+			<< arg << "." << std::endl;
+		return false;
+	}
 
-		// Create PNG write structure
-		png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL,
-			NULL, NULL);
-		if(png_ptr == NULL)
-		{
-			std::cerr << "Error creating PNG write structure for "
-				<< png_filename << "." << std::endl;
-			fclose(png_file);
-			return 1;
-		}
+	XyzReader xyz;
+	if(!xyz.Open(file.GetData(), file.GetSize())) {
+		err << "Input file " << arg
+			<< " is not a valid XYZ file: "
+			<< xyz.GetError() << "." << std::endl;
+		return false;
+	}
 
-		// Create PNG info structure
-		info_ptr = png_create_info_struct(png_ptr);
-		if(info_ptr == NULL)
-		{
-			std::cerr << "Error creating PNG info structure for "
-				<< png_filename << "." << std::endl;
-			fclose(png_file);
-			png_destroy_write_struct(&png_ptr, NULL);
-			return 1;
-		}
+	int width = xyz.GetWidth();
+	int height = xyz.GetHeight();
+	const uint8_t* xyz_palette = xyz.GetPalette();
+
+	FILE *png_file;
+	png_structp png_ptr;
+	png_infop info_ptr;
+	const std::string& png_filename = job.output;
+
+	// Open file for writing
+	png_file = fopen(png_filename.c_str(), "wb");
+	if(png_file == NULL) {
+		err << "Error creating file "
+			<< png_filename<< "." << std::endl;
+		return false;
+	}
 
-		// Init I/O functions
-		if(setjmp(png_jmpbuf(png_ptr)))
-		{
-			std::cerr << "Error initializing PNG I/O for "
-				<< png_filename << "." << std::endl;
-			fclose(png_file);
-			png_destroy_write_struct(&png_ptr, &info_ptr);
-			return 1;
-		}
-		png_init_io(png_ptr, png_file);
+	// Create PNG write structure
+	png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL,
+		NULL, NULL);
+	if(png_ptr == NULL)
+	{
+		err << "Error creating PNG write structure for "
+			<< png_filename << "." << std::endl;
+		fclose(png_file);
+		return false;
+	}
 
-		// Set compression parameters
-		png_set_compression_level(png_ptr, Z_BEST_COMPRESSION);
-		png_set_compression_mem_level(png_ptr, MAX_MEM_LEVEL);
-		png_set_compression_buffer_size(png_ptr, 1024 * 1024);
+	// Create PNG info structure
+	info_ptr = png_create_info_struct(png_ptr);
+	if(info_ptr == NULL)
+	{
+		err << "Error creating PNG info structure for "
+			<< png_filename << "." << std::endl;
+		fclose(png_file);
+		png_destroy_write_struct(&png_ptr, NULL);
+		return false;
+	}
 
-		// Write header
-		if(setjmp(png_jmpbuf(png_ptr))) {
-			std::cerr << "Error writing PNG header for "
-				<< png_filename << "." << std::endl;
-			fclose(png_file);
-			png_destroy_write_struct(&png_ptr, &info_ptr);
-			return 1;
-		}
-		png_set_IHDR(png_ptr, info_ptr, width, height, 8,
-			PNG_COLOR_TYPE_PALETTE, PNG_INTERLACE_NONE,
-			PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
+	// Init I/O functions
+	if(setjmp(png_jmpbuf(png_ptr)))
+	{
+		err << "Error initializing PNG I/O for "
+			<< png_filename << "." << std::endl;
+		fclose(png_file);
+		png_destroy_write_struct(&png_ptr, &info_ptr);
+		return false;
+	}
+	png_init_io(png_ptr, png_file);
+
+	// Set compression parameters
+	png_set_compression_level(png_ptr, profile.level);
+	png_set_compression_mem_level(png_ptr, profile.mem_level);
+	png_set_compression_strategy(png_ptr, profile.strategy);
+	if(profile.filters != PngProfile::filter_default) {
+		png_set_filter(png_ptr, PNG_FILTER_TYPE_BASE, profile.filters);
+	}
+	png_set_compression_buffer_size(png_ptr, 1024 * 1024);
 
-		// Write palette
-		if(setjmp(png_jmpbuf(png_ptr))) {
-			std::cerr << "Error writing PNG palette for "
-				<< png_filename << "." << std::endl;
-			fclose(png_file);
-			png_destroy_write_struct(&png_ptr, &info_ptr);
-			return 1;
-		}
-		png_colorp palette = (png_colorp) png_malloc(png_ptr,
-			PNG_MAX_PALETTE_LENGTH * (sizeof (png_color)));
-
-	 	for(int i = 0; i < PNG_MAX_PALETTE_LENGTH; i++)
-		{
-			palette[i].red = xyz_data[i * 3];
-			palette[i].green = xyz_data[i * 3 + 1];
-			palette[i].blue = xyz_data[i * 3 + 2];
-		}
-		png_set_PLTE(png_ptr, info_ptr, palette,
-			PNG_MAX_PALETTE_LENGTH);
+	// Write header
+	if(setjmp(png_jmpbuf(png_ptr))) {
+		err << "Error writing PNG header for "
+			<< png_filename << "." << std::endl;
+		fclose(png_file);
+		png_destroy_write_struct(&png_ptr, &info_ptr);
+		return false;
+	}
+	png_set_IHDR(png_ptr, info_ptr, width, height, 8,
+		PNG_COLOR_TYPE_PALETTE, PNG_INTERLACE_NONE,
+		PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
+
+	// Write palette
+	if(setjmp(png_jmpbuf(png_ptr))) {
+		err << "Error writing PNG palette for "
+			<< png_filename << "." << std::endl;
+		fclose(png_file);
+		png_destroy_write_struct(&png_ptr, &info_ptr);
+		return false;
+	}
+	png_colorp palette = (png_colorp) png_malloc(png_ptr,
+		PNG_MAX_PALETTE_LENGTH * (sizeof (png_color)));
 
-		png_write_info(png_ptr, info_ptr);
+ 	for(int i = 0; i < PNG_MAX_PALETTE_LENGTH; i++)
+	{
+		palette[i].red = xyz_palette[i * 3];
+		palette[i].green = xyz_palette[i * 3 + 1];
+		palette[i].blue = xyz_palette[i * 3 + 2];
+	}
+	png_set_PLTE(png_ptr, info_ptr, palette,
+		PNG_MAX_PALETTE_LENGTH);
 
-		png_bytep* row_pointers = new png_bytep[height];
-		for(int i = 0; i < height; i++) {
-			row_pointers[i] =
-				&xyz_data[768 + width * i];
-		}
-		png_write_image(png_ptr, row_pointers);
-		delete[] row_pointers;
-	
-		png_write_end(png_ptr, info_ptr);
+	png_write_info(png_ptr, info_ptr);
 
+	// Decode and write one row at a time
+	std::string error;
+	if(!WriteRows(png_ptr, xyz, pipeline, error)) {
+		err << "Error converting XYZ file "
+			<< arg << ": " << error << "." << std::endl;
 		png_free(png_ptr, palette);
-		palette = NULL;
-
 		png_destroy_write_struct(&png_ptr, &info_ptr);
+		fclose(png_file);
+		remove(png_filename.c_str());
+		return false;
+	}
 
+	// Write end
+	if(setjmp(png_jmpbuf(png_ptr))) {
+		err << "Error writing PNG end for "
+			<< png_filename << "." << std::endl;
+		png_free(png_ptr, palette);
+		png_destroy_write_struct(&png_ptr, &info_ptr);
 		fclose(png_file);
+		remove(png_filename.c_str());
+		return false;
 	}
+	png_write_end(png_ptr, info_ptr);
+
+	png_free(png_ptr, palette);
+	palette = NULL;
+
+	png_destroy_write_struct(&png_ptr, &info_ptr);
+
+	fclose(png_file);
 
-	return 0;
+	return true;
 }
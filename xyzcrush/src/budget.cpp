@@ -0,0 +1,88 @@
+/*
+ * This file is part of xyzcrush. Copyright (c) 2026 xyzcrush authors.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "budget.h"
+#include <algorithm>
+#include <cstdlib>
+
+TimeBudget::TimeBudget(Clock::duration total, Clock::duration per_file, unsigned int threads) :
+	start(Clock::now()), total(total), per_file(per_file), threads(std::max(1u, threads)) {
+}
+
+void TimeBudget::AddFile(uintmax_t weight) {
+	std::lock_guard<std::mutex> lock(mutex);
+	remaining_weight += weight;
+}
+
+TimeBudget::Clock::time_point TimeBudget::StartFile(uintmax_t weight) {
+	std::lock_guard<std::mutex> lock(mutex);
+	Clock::time_point now = Clock::now();
+	Clock::time_point deadline = Clock::time_point::max();
+
+	if (total > Clock::duration::zero()) {
+		Clock::time_point end = start + total;
+		Clock::duration left = std::max(end - now, Clock::duration::zero());
+
+		// the other threads spend the same time on the remaining files
+		double share = 1.0;
+		if (remaining_weight > 0) {
+			share = std::min(1.0, static_cast<double>(weight) * threads / remaining_weight);
+		}
+		deadline = now + std::chrono::duration_cast<Clock::duration>(left * share);
+	}
+
+	if (per_file > Clock::duration::zero()) {
+		deadline = std::min(deadline, now + per_file);
+	}
+
+	remaining_weight -= std::min(remaining_weight, weight);
+	return deadline;
+}
+
+int TimeBudget::ShouldStop(void* opaque) {
+	return Clock::now() >= *static_cast<const Clock::time_point*>(opaque) ? 1 : 0;
+}
+
+bool ParseDuration(const std::string& text, TimeBudget::Clock::duration& duration) {
+	char* end = nullptr;
+	double value = std::strtod(text.c_str(), &end);
+	if (end == text.c_str() || !(value > 0)) {
+		return false;
+	}
+
+	std::string unit(end);
+	double seconds;
+	if (unit.empty() || unit == "s") {
+		seconds = value;
+	} else if (unit == "ms") {
+		seconds = value / 1000;
+	} else if (unit == "m") {
+		seconds = value * 60;
+	} else if (unit == "h") {
+		seconds = value * 3600;
+	} else {
+		return false;
+	}
+	// more than 30 years overflows some clocks
+	if (seconds > 1e9) {
+		return false;
+	}
+
+	duration = std::chrono::duration_cast<TimeBudget::Clock::duration>(
+		std::chrono::duration<double>(seconds));
+	return true;
+}
@@ -0,0 +1,72 @@
+/*
+ * This file is part of xyzcrush. Copyright (c) 2026 xyzcrush authors.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XYZCRUSH_BUDGET_H
+#define XYZCRUSH_BUDGET_H
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+/**
+ * Shares a wall-clock budget between the files of a run.
+ *
+ * Every file gets a deadline when it starts: its share of the time left,
+ * weighted by its size against the files not started yet. Files finishing
+ * early (because their size stopped improving) leave more time for the
+ * files after them.
+ */
+class TimeBudget {
+public:
+	using Clock = std::chrono::steady_clock;
+
+	/**
+	 * @param total time for the whole run, zero for no limit
+	 * @param per_file time for a single file, zero for no limit
+	 * @param threads files compressed at the same time
+	 */
+	TimeBudget(Clock::duration total, Clock::duration per_file, unsigned int threads);
+
+	/** Announces a file, called for every file before the first one starts. */
+	void AddFile(uintmax_t weight);
+
+	/** Takes the share of a file announced with AddFile, returns its deadline. */
+	Clock::time_point StartFile(uintmax_t weight);
+
+	/** Zopfli should_stop hook, opaque points to a Clock::time_point. */
+	static int ShouldStop(void* opaque);
+
+private:
+	std::mutex mutex;
+	Clock::time_point start;
+	Clock::duration total;
+	Clock::duration per_file;
+	unsigned int threads;
+	// size of the files not started yet
+	uintmax_t remaining_weight = 0;
+};
+
+/**
+ * Parses durations like "90", "90s", "1500ms", "2m" or "1h" (plain numbers
+ * are seconds).
+ *
+ * @return false when the text is not a positive duration
+ */
+bool ParseDuration(const std::string& text, TimeBudget::Clock::duration& duration);
+
+#endif
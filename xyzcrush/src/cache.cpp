@@ -0,0 +1,134 @@
+/*
+ * This file is part of xyzcrush. Copyright (c) 2026 xyzcrush authors.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "cache.h"
+#include "tempname.h"
+#include <zlib.h>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+namespace {
+	constexpr char entry_magic[4] = { 'X', 'Y', 'Z', 'C' };
+	constexpr size_t entry_header_size = 8;
+
+	/** 64 bit FNV-1a, continues from the given hash. */
+	uint64_t Hash(const unsigned char* data, size_t size, uint64_t hash = 14695981039346656037ULL) {
+		for (size_t i = 0; i < size; i++) {
+			hash ^= data[i];
+			hash *= 1099511628211ULL;
+		}
+		return hash;
+	}
+}
+
+CrushCache::CrushCache(std::string directory) : directory(std::move(directory)) {
+}
+
+bool CrushCache::Init(std::string& error) {
+	std::error_code ec;
+	fs::create_directories(directory, ec);
+	if (ec || !fs::is_directory(directory, ec)) {
+		error = "Cannot use cache directory " + directory + ".";
+		return false;
+	}
+	return true;
+}
+
+std::string CrushCache::EntryPath(const std::vector<unsigned char>& payload,
+	const std::string& profile) const {
+	uint64_t key = Hash(reinterpret_cast<const unsigned char*>(profile.data()), profile.size());
+	key = Hash(payload.data(), payload.size(), key);
+
+	std::ostringstream ss;
+	ss << directory << "/" << std::hex << std::setw(16) << std::setfill('0') << key << ".zz";
+	return ss.str();
+}
+
+bool CrushCache::Lookup(const std::vector<unsigned char>& payload, const std::string& profile,
+	std::vector<unsigned char>& stream) const {
+	std::ifstream file(EntryPath(payload, profile), std::ios::binary | std::ios::ate);
+	if (!file) {
+		return false;
+	}
+
+	long size = file.tellg();
+	if (size <= static_cast<long>(entry_header_size)) {
+		return false;
+	}
+
+	unsigned char header[entry_header_size];
+	file.seekg(0, std::ios::beg);
+	file.read(reinterpret_cast<char*>(header), entry_header_size);
+	uint32_t payload_size = header[4] | (header[5] << 8) | (header[6] << 16)
+		| (static_cast<uint32_t>(header[7]) << 24);
+	if (memcmp(header, entry_magic, 4) != 0 || payload_size != payload.size()) {
+		return false;
+	}
+
+	stream.resize(size - entry_header_size);
+	file.read(reinterpret_cast<char*>(stream.data()), stream.size());
+	if (!file) {
+		return false;
+	}
+
+	// Only trust entries which really decode to this payload
+	std::vector<unsigned char> check(payload.size());
+	uLongf check_size = check.size();
+	if (uncompress(check.data(), &check_size, stream.data(), stream.size()) != Z_OK
+		|| check_size != payload.size() || check != payload) {
+		return false;
+	}
+
+	return true;
+}
+
+void CrushCache::Store(const std::vector<unsigned char>& payload, const std::string& profile,
+	const unsigned char* stream, size_t stream_size) const {
+	std::string path = EntryPath(payload, profile);
+
+	// Write to a private file first, so concurrent runs never see partial entries
+	std::string tmp_path = MakeTempName(path);
+
+	uint32_t payload_size = static_cast<uint32_t>(payload.size());
+	unsigned char header[entry_header_size];
+	memcpy(header, entry_magic, 4);
+	header[4] = payload_size & 0xFF;
+	header[5] = (payload_size >> 8) & 0xFF;
+	header[6] = (payload_size >> 16) & 0xFF;
+	header[7] = (payload_size >> 24) & 0xFF;
+
+	std::ofstream file(tmp_path, std::ofstream::binary);
+	file.write(reinterpret_cast<char*>(header), entry_header_size);
+	file.write(reinterpret_cast<const char*>(stream), stream_size);
+	file.close();
+
+	std::error_code ec;
+	if (!file) {
+		fs::remove(tmp_path, ec);
+		return;
+	}
+	fs::rename(tmp_path, path, ec);
+	if (ec) {
+		fs::remove(tmp_path, ec);
+	}
+}
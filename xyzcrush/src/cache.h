@@ -0,0 +1,61 @@
+/*
+ * This file is part of xyzcrush. Copyright (c) 2026 xyzcrush authors.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XYZCRUSH_CACHE_H
+#define XYZCRUSH_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * On-disk store of the best known zlib stream for an XYZ payload.
+ *
+ * Entries are addressed by a hash of the decompressed payload (palette and
+ * pixels) and of a profile string describing the compression settings.
+ * Every entry is inflated and compared against the payload before use, so
+ * hash collisions or damaged files never produce wrong images.
+ */
+class CrushCache {
+public:
+	explicit CrushCache(std::string directory);
+
+	/** Creates the cache directory when needed, returns false on error. */
+	bool Init(std::string& error);
+
+	/**
+	 * Fetches the best stream known for the payload.
+	 *
+	 * @param payload decompressed XYZ data
+	 * @param profile compression settings the entry was made with
+	 * @param stream receives the zlib stream
+	 * @return whether a valid entry was found
+	 */
+	bool Lookup(const std::vector<unsigned char>& payload, const std::string& profile,
+		std::vector<unsigned char>& stream) const;
+
+	/** Records a stream for the payload, replacing an older entry. */
+	void Store(const std::vector<unsigned char>& payload, const std::string& profile,
+		const unsigned char* stream, size_t stream_size) const;
+
+private:
+	std::string EntryPath(const std::vector<unsigned char>& payload, const std::string& profile) const;
+
+	std::string directory;
+};
+
+#endif
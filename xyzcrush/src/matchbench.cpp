@@ -0,0 +1,176 @@
+/*
+ * This file is part of xyzcrush. Copyright (c) 2026 xyzcrush authors.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Measures the match lengths Zopfli looks at while walking its hash chains,
+// once with the scalar loop and once with GetMatch (the SSE2 kernel where the
+// compiler targets it), and checks that both find the same lengths.
+// The pixels come from the given XYZ files, or from a generated tile map.
+
+// Headers
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "mappedfile.h"
+#include "xyzreader.h"
+#include "match.h"
+
+namespace {
+	// same limits as the LZ77 search of Zopfli
+	constexpr size_t max_match = 258;
+	constexpr size_t window_size = 32768;
+	constexpr int screen_width = 320;
+	constexpr int screen_height = 240;
+
+	struct Pair {
+		size_t pos;
+		size_t match;
+	};
+
+	// 16x16 tiles picked from a small set, like a map screenshot
+	std::vector<unsigned char> GenerateMap(std::mt19937& rng) {
+		std::vector<unsigned char> tiles(16 * 16 * 16);
+		for (auto& pixel : tiles) {
+			pixel = static_cast<unsigned char>(rng() % 24);
+		}
+
+		std::vector<unsigned char> pixels(screen_width * screen_height);
+		for (int ty = 0; ty < screen_height / 16; ty++) {
+			for (int tx = 0; tx < screen_width / 16; tx++) {
+				const unsigned char* tile = &tiles[(rng() % 16) * 16 * 16];
+				for (int y = 0; y < 16; y++) {
+					for (int x = 0; x < 16; x++) {
+						pixels[(ty * 16 + y) * screen_width + tx * 16 + x] = tile[y * 16 + x];
+					}
+				}
+			}
+		}
+		return pixels;
+	}
+
+	// Candidates a hash chain would return: the first 3 bytes are equal
+	void AddPairs(const std::vector<unsigned char>& data, size_t width,
+		std::mt19937& rng, std::vector<Pair>& pairs) {
+		for (size_t pos = 1; pos + 3 <= data.size(); pos++) {
+			size_t dists[] = { 1, 2, width, width * 16, 1 + rng() % window_size };
+			for (size_t dist : dists) {
+				if (dist > pos) {
+					continue;
+				}
+				size_t match = pos - dist;
+				if (data[pos] == data[match] && data[pos + 1] == data[match + 1]
+						&& data[pos + 2] == data[match + 2]) {
+					pairs.push_back({ pos, match });
+				}
+			}
+		}
+	}
+
+	template <typename F>
+	double Measure(int rounds, const std::vector<unsigned char>& data,
+		const std::vector<Pair>& pairs, size_t& total, F get_match) {
+		const unsigned char* base = data.data();
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < rounds; i++) {
+			total = 0;
+			for (const auto& pair : pairs) {
+				size_t limit = std::min(max_match, data.size() - pair.pos);
+				const unsigned char* scan = base + pair.pos;
+				const unsigned char* end = scan + limit;
+				total += get_match(scan, base + pair.match, end, end - 8) - scan;
+			}
+		}
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		return elapsed.count() / rounds;
+	}
+}
+
+int main(int argc, char** argv) {
+	int rounds = argc > 1 ? std::atoi(argv[1]) : 20;
+	if (rounds <= 0) {
+		std::cerr << "Usage: " << argv[0] << " [ROUNDS [FILE...]]\n";
+		return EXIT_FAILURE;
+	}
+
+	std::mt19937 rng(1);
+	std::vector<unsigned char> data;
+	std::vector<Pair> pairs;
+
+	// All images go into one buffer, candidates are searched per image
+	std::vector<std::vector<unsigned char>> images;
+	std::vector<size_t> widths;
+	for (int i = 2; i < argc; i++) {
+		MappedFile file;
+		XyzReader xyz;
+		std::vector<unsigned char> pixels;
+		if (!file.Open(argv[i]) || !xyz.Open(file.GetData(), file.GetSize())
+				|| !xyz.ReadPayload(pixels)) {
+			std::cerr << "Error reading XYZ file " << argv[i] << ".\n";
+			return EXIT_FAILURE;
+		}
+		// palette and pixels, the data Zopfli compresses
+		images.push_back(std::move(pixels));
+		widths.push_back(xyz.GetWidth());
+	}
+	if (images.empty()) {
+		images.push_back(GenerateMap(rng));
+		widths.push_back(screen_width);
+	}
+
+	for (size_t i = 0; i < images.size(); i++) {
+		std::vector<Pair> image_pairs;
+		AddPairs(images[i], widths[i], rng, image_pairs);
+		for (auto& pair : image_pairs) {
+			pairs.push_back({ pair.pos + data.size(), pair.match + data.size() });
+		}
+		data.insert(data.end(), images[i].begin(), images[i].end());
+	}
+	if (data.size() < 8 || pairs.empty()) {
+		std::cerr << "Not enough data to match.\n";
+		return EXIT_FAILURE;
+	}
+
+	size_t scalar_total = 0, kernel_total = 0;
+	double scalar_ms = Measure(rounds, data, pairs, scalar_total, GetMatchScalar);
+	double kernel_ms = Measure(rounds, data, pairs, kernel_total, GetMatch);
+
+	bool same = scalar_total == kernel_total;
+	for (const auto& pair : pairs) {
+		size_t limit = std::min(max_match, data.size() - pair.pos);
+		const unsigned char* scan = data.data() + pair.pos;
+		const unsigned char* match = data.data() + pair.match;
+		if (GetMatchScalar(scan, match, scan + limit, scan + limit - 8)
+				!= GetMatch(scan, match, scan + limit, scan + limit - 8)) {
+			same = false;
+		}
+	}
+
+	std::cout << pairs.size() << " matches in " << data.size() << " bytes, "
+		<< rounds << " rounds, average length "
+		<< static_cast<double>(scalar_total) / pairs.size() << "\n"
+		<< "  scalar:   " << scalar_ms << " ms/round\n"
+#ifdef ZOPFLI_SSE2
+		<< "  GetMatch: " << kernel_ms << " ms/round (SSE2)\n"
+#else
+		<< "  GetMatch: " << kernel_ms << " ms/round (scalar, no SSE2)\n"
+#endif
+		<< "  lengths " << (same ? "identical" : "DIFFER") << "\n";
+
+	return same ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,135 @@
+/*
+ * This file is part of xyzcrush. Copyright (c) 2026 xyzcrush authors.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "strategy.h"
+#include <zlib.h>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include "arena.h"
+#include "zlib_container.h"
+
+namespace {
+	Strategy MakeZopfli(int iterations, bool block_splitting) {
+		Strategy s;
+		s.type = Strategy::Type::Zopfli;
+		s.iterations = iterations;
+		s.block_splitting = block_splitting;
+		s.name = "zopfli i" + std::to_string(iterations) + (block_splitting ? " split" : " nosplit");
+		return s;
+	}
+
+	Strategy MakeZlib(int level, int mem_level, int zlib_strategy, const char* strategy_name) {
+		Strategy s;
+		s.type = Strategy::Type::Zlib;
+		s.level = level;
+		s.mem_level = mem_level;
+		s.zlib_strategy = zlib_strategy;
+		s.name = "zlib " + std::to_string(level) + " mem" + std::to_string(mem_level)
+			+ " " + strategy_name;
+		return s;
+	}
+
+	// freed blocks kept per thread, see SetZopfliArenaLimit
+	std::atomic<size_t> arena_limit{default_arena_limit};
+
+	/** Owns the arena of a thread. */
+	struct ThreadArena {
+		ZopfliArena* arena;
+
+		ThreadArena() : arena(ZopfliCreateArena(arena_limit)) {
+			ZopfliSetThreadArena(arena);
+		}
+
+		~ThreadArena() {
+			ZopfliSetThreadArena(nullptr);
+			ZopfliDestroyArena(arena);
+		}
+	};
+}
+
+void SetZopfliArenaLimit(size_t bytes) {
+	arena_limit = bytes;
+}
+
+void UseZopfliArena() {
+	static thread_local ThreadArena thread_arena;
+	(void)thread_arena;
+}
+
+bool Strategy::Compress(const std::vector<unsigned char>& payload, const ZopfliOptions& base,
+	std::vector<unsigned char>& stream) const {
+	if (type == Type::Zopfli) {
+		ZopfliOptions options = base;
+		options.numiterations = iterations;
+		options.blocksplitting = block_splitting ? 1 : 0;
+
+		UseZopfliArena();
+
+		size_t comp_size = 0;
+		unsigned char* comp_data = 0;
+		ZopfliZlibCompress(&options, payload.data(), payload.size(), &comp_data, &comp_size);
+		stream.assign(comp_data, comp_data + comp_size);
+		free(comp_data);
+		return true;
+	}
+
+	z_stream strm;
+	memset(&strm, 0, sizeof(strm));
+	if (deflateInit2(&strm, level, Z_DEFLATED, MAX_WBITS, mem_level, zlib_strategy) != Z_OK) {
+		return false;
+	}
+
+	stream.resize(deflateBound(&strm, payload.size()));
+	strm.next_in = const_cast<Bytef*>(payload.data());
+	strm.avail_in = payload.size();
+	strm.next_out = stream.data();
+	strm.avail_out = stream.size();
+
+	int status = deflate(&strm, Z_FINISH);
+	stream.resize(strm.total_out);
+	deflateEnd(&strm);
+
+	return status == Z_STREAM_END;
+}
+
+std::vector<Strategy> GetDefaultStrategies() {
+	return { MakeZopfli(15, true) };
+}
+
+std::vector<Strategy> GetRaceStrategies() {
+	std::vector<Strategy> strategies;
+
+	for (int mem_level : {8, MAX_MEM_LEVEL}) {
+		for (int level = 1; level <= 9; level++) {
+			strategies.push_back(MakeZlib(level, mem_level, Z_DEFAULT_STRATEGY, "default"));
+			// the fast levels ignore this
+			if (level >= 4) {
+				strategies.push_back(MakeZlib(level, mem_level, Z_FILTERED, "filtered"));
+			}
+		}
+		// the level makes no difference here
+		strategies.push_back(MakeZlib(9, mem_level, Z_RLE, "rle"));
+	}
+
+	for (int iterations : {5, 15, 30}) {
+		strategies.push_back(MakeZopfli(iterations, true));
+		strategies.push_back(MakeZopfli(iterations, false));
+	}
+
+	return strategies;
+}
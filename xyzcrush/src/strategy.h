@@ -0,0 +1,79 @@
+/*
+ * This file is part of xyzcrush. Copyright (c) 2026 xyzcrush authors.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef XYZCRUSH_STRATEGY_H
+#define XYZCRUSH_STRATEGY_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "zopfli.h"
+
+/** One way of compressing the XYZ payload into a zlib stream. */
+struct Strategy {
+	enum class Type {
+		Zlib,
+		Zopfli
+	};
+
+	Type type;
+	std::string name;
+
+	// zlib settings
+	int level = 9;
+	int mem_level = 8;
+	int zlib_strategy = 0;
+
+	// Zopfli settings
+	int iterations = 15;
+	bool block_splitting = true;
+
+	/**
+	 * Compresses the payload.
+	 *
+	 * @param payload decompressed XYZ data
+	 * @param base Zopfli options to start from (hooks, verbosity)
+	 * @param stream receives the zlib stream
+	 * @return false on error
+	 */
+	bool Compress(const std::vector<unsigned char>& payload, const ZopfliOptions& base,
+		std::vector<unsigned char>& stream) const;
+};
+
+// freed Zopfli buffers kept per thread by default
+constexpr size_t default_arena_limit = 32 * 1024 * 1024;
+
+/**
+ * Sets how many bytes of freed buffers the arena of a thread keeps.
+ * Only arenas created afterwards use the new limit.
+ */
+void SetZopfliArenaLimit(size_t bytes);
+
+/**
+ * Gives the calling thread a Zopfli arena, so the hash tables, caches and
+ * LZ77 stores are reused by all files the thread compresses. The arena is
+ * freed when the thread ends.
+ */
+void UseZopfliArena();
+
+/** Returns the classic xyzcrush setting: Zopfli, 15 iterations, block splitting. */
+std::vector<Strategy> GetDefaultStrategies();
+
+/** Returns zlib levels 1-9 with several memLevel/strategy choices and Zopfli variants. */
+std::vector<Strategy> GetRaceStrategies();
+
+#endif
@@ -16,15 +16,28 @@
  */
 
 #include <zlib.h>
+#include <atomic>
+#include <cctype>
+#include <cstdlib>
 #include <cstring>
+#include <filesystem>
 #include <iostream>
 #include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <vector>
-#ifdef _WIN32
-# include <algorithm>
-#endif
+#include <algorithm>
+#include <argparse.hpp>
 #include "zlib_container.h"
+#include "jobpool.h"
+#include "budget.h"
+#include "cache.h"
+#include "strategy.h"
+#include "mappedfile.h"
+#include "palette.h"
+#include "xyzreader.h"
 
 # ifdef __MINGW64_VERSION_MAJOR
 int _dowildcard = -1; /* enable wildcard expansion for mingw-w64 */
@@ -73,8 +86,294 @@ std::string GetPath(const std::string& str) {
 	return s;
 }
 
+namespace {
+	/** Console output of a single file, printed once it is its turn. */
+	struct FileReport {
+		std::string output;
+		std::string error;
+		bool finished = false;
+	};
+
+	// iterations of the Zopfli strategies are multiplied by this with a budget
+	constexpr int budget_iteration_factor = 8;
+	// a block stops iterating after that many iterations without a smaller result
+	constexpr int budget_stagnation = 20;
+	// freed Zopfli buffers kept by all threads together, unless set with --arena-cache
+	constexpr size_t max_arena_total = 256 * 1024 * 1024;
+
+	/** Counts how often each strategy produced the smallest stream. */
+	struct StrategyStats {
+		std::mutex mutex;
+		// one entry per strategy, the last one counts kept originals
+		std::vector<unsigned int> wins;
+	};
+
+	/** How files are recompressed. */
+	struct CrushSettings {
+		ZopfliOptions zopfli;
+		std::vector<Strategy> strategies;
+		JobPool* pool = nullptr;
+		StrategyStats* stats = nullptr;
+		bool sort_palette = false;
+		const CrushCache* cache = nullptr;
+		TimeBudget* budget = nullptr;
+		// describes the settings above for the cache
+		std::string profile;
+	};
+}
+
+/** Writes an XYZ file, returns false on error. */
+static bool WriteXyz(const std::string& filename, unsigned short width, unsigned short height,
+	const unsigned char* data, size_t size);
+
+/**
+ * Recompresses one XYZ file, returns false on error.
+ * With a budget the Zopfli iterations end at the deadline.
+ */
+static bool CrushFile(const std::string& filename, const CrushSettings& settings,
+	const TimeBudget::Clock::time_point* deadline, FileReport& report) {
+	std::ostringstream out, err;
+
+	MappedFile file;
+	if (!file.Open(filename)) {
+		err << "Error reading file " << filename << "." << std::endl;
+		report.error = err.str();
+		return false;
+	}
+
+	size_t size = file.GetSize();
+
+	XyzReader xyz;
+	std::vector<Bytef> xyz_data;
+	if (!xyz.Open(file.GetData(), size) || !xyz.ReadPayload(xyz_data)) {
+		err << "XYZ error in file " << filename << ": " << xyz.GetError() << "." << std::endl;
+		report.error = err.str();
+		return false;
+	}
+
+	unsigned short width = xyz.GetWidth();
+	unsigned short height = xyz.GetHeight();
+
+	// the original stream (behind the header), kept when nothing beats it
+	const Bytef* original = file.GetData() + 8;
+	size_t original_size = size - 8;
+
+	std::string xyz_filename = GetFilename(filename) + std::string(".xyz");
+
+	std::vector<unsigned char> best;
+	std::string note;
+
+	// Relabel the palette, the image stays the same
+	// The payload of the file is kept for the cache, the original stream decodes to it
+	std::vector<Bytef> file_payload;
+	if (settings.sort_palette) {
+		if (settings.cache) {
+			file_payload = xyz_data;
+		}
+		Palette::Order order = Palette::Optimize(xyz_data);
+		if (order != Palette::Order::Identity) {
+			note = std::string(Palette::GetOrderName(order)) + " palette";
+		} else {
+			file_payload.clear();
+		}
+	}
+
+	// Reuse the best stream from an earlier run, when the original won it is
+	// stored under the payload of the file
+	if (settings.cache && (settings.cache->Lookup(xyz_data, settings.profile, best)
+		|| (!file_payload.empty() && settings.cache->Lookup(file_payload, settings.profile, best)))) {
+		note += note.empty() ? "cached" : ", cached";
+	} else {
+		ZopfliOptions zopfli = settings.zopfli;
+		if (deadline) {
+			zopfli.should_stop = TimeBudget::ShouldStop;
+			zopfli.stop_opaque = const_cast<TimeBudget::Clock::time_point*>(deadline);
+		}
+
+		const auto& strategies = settings.strategies;
+		std::vector<std::vector<unsigned char>> streams(strategies.size());
+		std::vector<char> compressed(strategies.size());
+
+		auto compress = [&](size_t i) {
+			compressed[i] = strategies[i].Compress(xyz_data, zopfli, streams[i]);
+		};
+		if (settings.pool && strategies.size() > 1) {
+			settings.pool->ParallelFor(strategies.size(), compress);
+		} else {
+			for (size_t i = 0; i < strategies.size(); i++) {
+				compress(i);
+			}
+		}
+
+		// Smallest stream wins, ties go to the original and then to the earlier strategy
+		size_t winner = strategies.size();
+		size_t winner_size = original_size;
+		for (size_t i = 0; i < strategies.size(); i++) {
+			if (compressed[i] && streams[i].size() < winner_size) {
+				winner = i;
+				winner_size = streams[i].size();
+			}
+		}
+
+		if (settings.stats) {
+			std::lock_guard<std::mutex> lock(settings.stats->mutex);
+			settings.stats->wins[winner]++;
+		}
+
+		if (winner == strategies.size()) {
+			best.assign(original, original + original_size);
+		} else {
+			best = std::move(streams[winner]);
+			if (settings.stats) {
+				note += (note.empty() ? "" : ", ") + strategies[winner].name;
+			}
+		}
+
+		// A result cut short by the deadline depends on the time it got, only
+		// store results that ended on their own (the same with any budget)
+		bool cut_short = deadline && TimeBudget::Clock::now() >= *deadline;
+		if (settings.cache && !cut_short) {
+			bool original_won = winner == strategies.size() && !file_payload.empty();
+			settings.cache->Store(original_won ? file_payload : xyz_data, settings.profile,
+				best.data(), best.size());
+		}
+	}
+
+	// Never make a file bigger
+	const unsigned char* result = best.data();
+	size_t result_size = best.size();
+	if (original_size <= best.size()) {
+		std::error_code ec;
+		if (std::filesystem::equivalent(filename, xyz_filename, ec)) {
+			out << "Input file " << filename << ": " << size
+				<< " (already optimal, skipped)" << std::endl;
+			report.output = out.str();
+			return true;
+		}
+
+		// copied, as the mapping is closed before writing
+		best.assign(original, original + original_size);
+		result = best.data();
+		result_size = best.size();
+		note = "original kept";
+	}
+
+	// The output is usually the input, Windows cannot truncate a mapped file
+	file.Close();
+
+	if (!WriteXyz(xyz_filename, width, height, result, result_size)) {
+		err << "Error writing file " << xyz_filename << "." << std::endl;
+		report.error = err.str();
+		return false;
+	}
+
+	out << "Input file " << filename << ": " << size << "->"
+		<< result_size + 8 << " (" << (result_size + 8) * 100 / size << "%";
+	if (!note.empty()) {
+		out << ", " << note;
+	}
+	out << ")" << std::endl;
+	report.output = out.str();
+
+	return true;
+}
+
+static bool WriteXyz(const std::string& filename, unsigned short width, unsigned short height,
+	const unsigned char* data, size_t size) {
+	std::ofstream xyz_file(filename, std::ofstream::binary);
+	xyz_file.write("XYZ1", 4);
+	xyz_file.write(reinterpret_cast<char*>(&width), 2);
+	xyz_file.write(reinterpret_cast<char*>(&height), 2);
+	xyz_file.write(reinterpret_cast<const char*>(data), size);
+	xyz_file.close();
+
+	return static_cast<bool>(xyz_file);
+}
+
+/** Lets Zopfli optimize independent blocks on the job pool. */
+static void PoolParallelFor(void* opaque, size_t count,
+	void (*job)(void* context, size_t i), void* context) {
+	static_cast<JobPool*>(opaque)->ParallelFor(count,
+		[job, context](size_t i) {
+			UseZopfliArena();
+			job(context, i);
+		});
+}
+
 int main(int argc, char* argv[]) {
-	ZopfliOptions zopfli_options;
+	std::vector<std::string> files;
+	int jobs = 1;
+	bool parallel_blocks = false;
+	std::string cache_dir;
+	bool race = false;
+	bool sort_palette = false;
+	std::string budget_text;
+	std::string file_budget_text;
+	int arena_cache = -1;
+
+	argparse::ArgumentParser cli("xyzcrush", PACKAGE_VERSION);
+	cli.set_usage_max_line_width(100);
+	cli.add_description("Recompress XYZ images into smaller files.");
+	cli.add_epilog("Homepage " PACKAGE_URL " - Report bugs at: " PACKAGE_BUGREPORT);
+
+	cli.add_argument("FILE").nargs(argparse::nargs_pattern::at_least_one)
+		.store_into(files).help("XYZ files to recompress");
+	cli.add_argument("-j", "--jobs").store_into(jobs).metavar("N")
+		.help("Recompress N files in parallel (0: one per CPU core, default: 1)");
+	cli.add_argument("-p", "--parallel-blocks").store_into(parallel_blocks)
+		.help("Also optimize the blocks of a file in parallel, helps with few\n"
+			"big files (uses the -j threads, or one per CPU core without -j,\n"
+			"output does not change)");
+	cli.add_argument("-r", "--race").store_into(race)
+		.help("Try many zlib and Zopfli settings and keep the smallest result,\n"
+			"reports how often each setting won");
+	cli.add_argument("-s", "--sort-palette").store_into(sort_palette)
+		.help("Reorder the palette (by frequency, luminance or colour\n"
+			"distance) when it makes the file smaller, index 0 is kept");
+	cli.add_argument("-b", "--budget").store_into(budget_text).metavar("TIME")
+		.help("Spend about TIME (e.g. 90s, 10m, 1h) on all files: iterates\n"
+			"longer but stops once a file stops improving, the time saved\n"
+			"goes to the remaining files (smallest files go first)");
+	cli.add_argument("--file-budget").store_into(file_budget_text).metavar("TIME")
+		.help("Like --budget, but limits every file on its own");
+	cli.add_argument("--arena-cache").store_into(arena_cache).metavar("MB")
+		.help("Keep up to MB MiB of freed Zopfli buffers for reuse, shared\n"
+			"by all threads (default: 32 per thread, at most 256)");
+	cli.add_argument("-c", "--cache").store_into(cache_dir).metavar("DIR")
+		.help("Remember the best result of every image in DIR and reuse it\n"
+			"on later runs, files already as small are left untouched");
+
+	try {
+		cli.parse_args(argc, argv);
+	} catch (const std::exception& err) {
+		std::cerr << err.what() << "\n";
+		// print usage message
+		std::cerr << cli.usage() << "\n";
+		std::exit(EXIT_FAILURE);
+	}
+
+	if (jobs < 0) {
+		std::cerr << "Invalid amount of jobs: " << jobs << "\n";
+		std::exit(EXIT_FAILURE);
+	}
+	if (arena_cache < -1) {
+		std::cerr << "Invalid arena cache size: " << arena_cache << "\n";
+		std::exit(EXIT_FAILURE);
+	}
+
+	TimeBudget::Clock::duration total_budget{}, file_budget{};
+	if (!budget_text.empty() && !ParseDuration(budget_text, total_budget)) {
+		std::cerr << "Invalid budget: " << budget_text << "\n";
+		std::exit(EXIT_FAILURE);
+	}
+	if (!file_budget_text.empty() && !ParseDuration(file_budget_text, file_budget)) {
+		std::cerr << "Invalid file budget: " << file_budget_text << "\n";
+		std::exit(EXIT_FAILURE);
+	}
+	bool budgeted = !budget_text.empty() || !file_budget_text.empty();
+
+	CrushSettings settings;
+	ZopfliOptions& zopfli_options = settings.zopfli;
 	ZopfliInitOptions(&zopfli_options);
 	zopfli_options.verbose = 0;
 	zopfli_options.verbose_more = 0;
@@ -83,84 +382,178 @@ int main(int argc, char* argv[]) {
 	zopfli_options.blocksplittinglast = 0;
 	zopfli_options.blocksplittingmax = 15;
 
-	if (argc < 2) {
-		std::cout << "Usage: " << argv[0]
-			<< " filename" << std::endl;
-		return 1;
+	StrategyStats stats;
+	settings.sort_palette = sort_palette;
+	settings.strategies = race ? GetRaceStrategies() : GetDefaultStrategies();
+	if (budgeted) {
+		zopfli_options.stagnation = budget_stagnation;
+		for (auto& strategy : settings.strategies) {
+			strategy.iterations *= budget_iteration_factor;
+		}
+	}
+	if (race) {
+		stats.wins.resize(settings.strategies.size() + 1);
+		settings.stats = &stats;
 	}
 
-	unsigned int errors = 0;
-	char header[5];
-
-	for (int arg = 1; arg < argc; arg++) {
-		std::ifstream file(argv[arg],
-			std::ios::binary | std::ios::ate);
-		if (!file) {
-			std::cerr << "Error reading file " << argv[arg] << "."
-				<< std::endl;
-			errors++;
-			continue;
+	std::unique_ptr<CrushCache> cache;
+	if (!cache_dir.empty()) {
+		std::string error;
+		cache = std::make_unique<CrushCache>(cache_dir);
+		if (!cache->Init(error)) {
+			std::cerr << error << "\n";
+			std::exit(EXIT_FAILURE);
 		}
 
-		long size = file.tellg();
-		header[4] = '\0';
+		std::ostringstream profile;
+		for (const auto& strategy : settings.strategies) {
+			profile << strategy.name << ";";
+		}
+		profile << "bsm" << zopfli_options.blocksplittingmax;
+		if (sort_palette) {
+			profile << ";palette";
+		}
+		if (budgeted) {
+			profile << ";budget";
+		}
+		settings.profile = profile.str();
+		settings.cache = cache.get();
+	}
 
-		file.seekg(0, std::ios::beg);
-		file.read(header, 4);
+	std::unique_ptr<JobPool> pool;
+	if (jobs != 1) {
+		pool = std::make_unique<JobPool>(jobs);
+	}
+	settings.pool = pool.get();
 
-		if (memcmp(header, "XYZ1", 4) != 0) {
-			std::cerr << "Input file " << argv[arg]
-				<< " is not an XYZ file: '" << header << "'." << std::endl;
-			errors++;
-			continue;
+	// Without -j the files run one after another, their blocks get an own pool
+	std::unique_ptr<JobPool> block_pool;
+	if (parallel_blocks) {
+		JobPool* blocks = pool.get();
+		if (!blocks) {
+			block_pool = std::make_unique<JobPool>(0);
+			blocks = block_pool.get();
 		}
+		zopfli_options.parallel_for = PoolParallelFor;
+		zopfli_options.parallel_opaque = blocks;
+	}
 
-		unsigned short width;
-		unsigned short height;
-		file.read((char*) &width, 2);
-		file.read((char*) &height, 2);
+	// Split the buffer cache between the workers and the main thread
+	size_t arena_threads = 1 + (pool ? pool->GetThreadCount() : 0)
+		+ (block_pool ? block_pool->GetThreadCount() : 0);
+	size_t arena_total = arena_cache >= 0 ? static_cast<size_t>(arena_cache) * 1024 * 1024
+		: std::min(default_arena_limit * arena_threads, max_arena_total);
+	SetZopfliArenaLimit(arena_total / arena_threads);
 
-		int compressed_xyz_size = size - 8;
-		Bytef* compressed_xyz_data = new Bytef[compressed_xyz_size];
+	// Small files first, the time they do not need goes to the big ones
+	std::vector<size_t> order(files.size());
+	for (size_t i = 0; i < order.size(); i++) {
+		order[i] = i;
+	}
 
-		file.read((char*) compressed_xyz_data, compressed_xyz_size);
+	// All outputs go to the current directory, files with the same name
+	// would overwrite each other, so only the first of them is crushed
+	std::vector<FileReport> reports(files.size());
+	std::vector<bool> skipped(files.size());
+	std::map<std::string, size_t> outputs;
+	for (size_t i = 0; i < files.size(); i++) {
+		std::string output = GetFilename(files[i]) + std::string(".xyz");
+		std::string key = output;
+#ifdef _WIN32
+		std::transform(key.begin(), key.end(), key.begin(),
+			[](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+#endif
+		auto it = outputs.emplace(key, i);
+		if (!it.second) {
+			reports[i].error = "Error: " + output + " is already written for "
+				+ files[it.first->second] + ", skipped " + files[i] + ".\n";
+			skipped[i] = true;
+		}
+	}
 
-		uLongf xyz_size = 768 + (width * height);
-		Bytef* xyz_data = new Bytef[xyz_size];
+	std::unique_ptr<TimeBudget> budget;
+	std::vector<uintmax_t> weights(files.size());
+	if (budgeted) {
+		budget = std::make_unique<TimeBudget>(total_budget, file_budget,
+			pool ? pool->GetThreadCount() : 1);
+		for (size_t i = 0; i < files.size(); i++) {
+			if (skipped[i]) {
+				continue;
+			}
+			std::error_code ec;
+			weights[i] = std::filesystem::file_size(files[i], ec);
+			if (ec) {
+				weights[i] = 0;
+			}
+			budget->AddFile(weights[i]);
+		}
+		std::stable_sort(order.begin(), order.end(),
+			[&weights](size_t a, size_t b) { return weights[a] < weights[b]; });
+		settings.budget = budget.get();
+	}
 
-		int status = uncompress(xyz_data, &xyz_size, compressed_xyz_data,
-			compressed_xyz_size);
+	std::atomic<unsigned int> errors{0};
+	size_t next_report = 0;
+	std::mutex report_mutex;
 
-		if (status != Z_OK) {
-			std::cerr << "XYZ error in file " << argv[arg] << "." << std::endl;
+	auto crush = [&](size_t i) {
+		if (skipped[i]) {
 			errors++;
-			continue;
+		} else {
+			TimeBudget::Clock::time_point deadline;
+			if (settings.budget) {
+				deadline = settings.budget->StartFile(weights[i]);
+			}
+			if (!CrushFile(files[i], settings, settings.budget ? &deadline : nullptr, reports[i])) {
+				errors++;
+			}
 		}
-		delete[] compressed_xyz_data;
-
-		// Compress XYZ data
-		size_t comp_size = 0;
-		unsigned char* comp_data = 0;
 
-		ZopfliZlibCompress(&zopfli_options, xyz_data, xyz_size, &comp_data,
-			&comp_size);
+		// Print in input order, so wait for all previous files
+		std::lock_guard<std::mutex> lock(report_mutex);
+		reports[i].finished = true;
+		while (next_report < reports.size() && reports[next_report].finished) {
+			std::cerr << reports[next_report].error << std::flush;
+			std::cout << reports[next_report].output << std::flush;
+			reports[next_report].output.clear();
+			reports[next_report].error.clear();
+			next_report++;
+		}
+	};
 
-		delete[] xyz_data;
+	if (!pool) {
+		for (size_t i : order) {
+			crush(i);
+		}
+	} else {
+		// Workers take the files from a shared counter, so they start in order
+		std::atomic<size_t> next{0};
+		for (unsigned int t = 0; t < pool->GetThreadCount(); t++) {
+			pool->Submit([&crush, &order, &next]() {
+				size_t k;
+				while ((k = next++) < order.size()) {
+					crush(order[k]);
+				}
+			});
+		}
+		pool->Wait();
+	}
 
-		std::stringstream ss;
-		ss << GetFilename(argv[arg]) + std::string(".xyz");
-		std::string xyz_filename = ss.str();
-		std::ofstream xyz_file(xyz_filename.c_str(), std::ofstream::binary);
-		xyz_file.write("XYZ1", 4);
-		xyz_file.write(reinterpret_cast<char*>(&width), 2);
-		xyz_file.write(reinterpret_cast<char*>(&height), 2);
-		xyz_file.write(reinterpret_cast<char*>(comp_data), comp_size);
-		xyz_file.close();
-		delete[] comp_data;
+	if (race) {
+		std::vector<std::pair<unsigned int, std::string>> ranking;
+		for (size_t i = 0; i < stats.wins.size(); i++) {
+			if (stats.wins[i] > 0) {
+				ranking.emplace_back(stats.wins[i],
+					i < settings.strategies.size() ? settings.strategies[i].name : "original");
+			}
+		}
+		std::stable_sort(ranking.begin(), ranking.end(),
+			[](const auto& a, const auto& b) { return a.first > b.first; });
 
-		std::cout << "Input file " << argv[arg] << ": " << size << "->"
-			<< comp_size + 8 << " (" << (comp_size + 8) * 100 / size << "%)"
-			<< std::endl;
+		std::cout << "Strategy wins:" << std::endl;
+		for (const auto& entry : ranking) {
+			std::cout << "  " << entry.second << ": " << entry.first << std::endl;
+		}
 	}
 
 	if (errors > 0) {